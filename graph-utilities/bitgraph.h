@@ -0,0 +1,204 @@
+#ifndef BITGRAPH_H
+#define BITGRAPH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bitset graph representation shared by the graph programs (graph-utilities and thesis-verification/C)
+ *
+ * A graph on at most BG_MAX_VERTICES vertices is stored as one neighbourhood mask per vertex: bit w of
+ *  nbrs[v] is set if vw is an edge. Sets of vertices are stored as masks in the same way, so for example
+ *  a set S is stable exactly when (S & nbrs[v]) == 0 for every v in S.
+ * See the documentation for g6 format (from B. McKay and A. Piperino's nauty & traces)
+ */
+
+#define BG_MAX_VERTICES 64
+
+// g6 format magic number (see documentation)
+#define G6_START_CHAR 63
+
+typedef uint64_t VertexSet;
+
+typedef struct Graph {
+    int nVerts;
+    VertexSet nbrs[BG_MAX_VERTICES];
+} Graph;
+
+// The set {v} and the set {0,...,n-1}
+#define VERTEX_BIT(v) ((VertexSet) 1 << (v))
+#define ALL_VERTICES(n) ((n) >= 64 ? ~(VertexSet) 0 : VERTEX_BIT(n) - 1)
+
+
+// Make g the graph with n vertices and no edges
+static inline void graphInit (Graph *g, int n) {
+    g->nVerts = n;
+    for (int v = 0; v < n; v += 1) {
+        g->nbrs[v] = 0;
+    }
+}
+
+
+static inline void graphAddEdge (Graph *g, int u, int v) {
+    g->nbrs[u] |= VERTEX_BIT(v);
+    g->nbrs[v] |= VERTEX_BIT(u);
+}
+
+
+// Returns 1 if uv is an edge of g, 0 otherwise
+static inline int graphHasEdge (const Graph *g, int u, int v) {
+    return (g->nbrs[u] >> v) & 1;
+}
+
+
+// Returns 1 if the set of vertices S is stable in g, 0 otherwise
+static inline int isStableSet (const Graph *g, VertexSet S) {
+    for (VertexSet rest = S; rest != 0; rest &= rest - 1) {
+        if (g->nbrs[__builtin_ctzll(rest)] & S) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+// Record which subsets of V(g) are stable (stable[S] is 1 if S is stable, 0 otherwise)
+// Assumes 'stable' has 2^(g->nVerts) entries (so this is only sensible for small graphs)
+static inline void fillStableTable (const Graph *g, char *stable) {
+    // A non-empty set is stable if removing its least element leaves a stable set not adjacent to that element
+    stable[0] = 1;
+    for (VertexSet S = 1; S < VERTEX_BIT(g->nVerts); S += 1) {
+        VertexSet rest = S & (S - 1);
+        stable[S] = stable[rest] && (g->nbrs[__builtin_ctzll(S)] & rest) == 0;
+    }
+}
+
+
+// Reverse the order of the bits of x
+static inline uint32_t reverseBits32 (uint32_t x) {
+    x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+    x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+    x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+
+// Decode the body of a g6 string (the part after the number of vertices, 'len' characters long) into g
+// Assumes g->nVerts has already been set
+// Returns the number of characters used, or -1 if the body ended before all the edges were read
+static inline int g6DecodeBody (const char *body, size_t len, Graph *g) {
+    int n = g->nVerts;
+    graphInit(g, n);
+
+    // Bits are listed column by column in the upper triangle of the adjacency matrix: (0,1),(0,2),(1,2),(0,3),...
+    // so column j is the next j bits (most significant first), which we take (at most 32 at a time) from a buffer
+    //  filled 6 bits per character and turn into the mask of the neighbours of j before it
+    uint64_t buf = 0;
+    int bufBits = 0;
+    size_t pos = 0;
+    for (int j = 1; j < n; j += 1) {
+        VertexSet before = 0;
+        for (int first = 0; first < j; first += 32) {
+            int count = (j - first < 32) ? j - first : 32;
+            while (bufBits < count) {
+                if (pos >= len) {
+                    return -1;
+                }
+                buf = (buf << 6) | ((body[pos] - G6_START_CHAR) & 0x3F);
+                bufBits += 6;
+                pos += 1;
+            }
+            uint32_t bits = (buf >> (bufBits - count)) & (((uint64_t) 1 << count) - 1);
+            bufBits -= count;
+            before |= (VertexSet)(reverseBits32(bits) >> (32 - count)) << first;
+        }
+
+        g->nbrs[j] = before;
+        for (VertexSet rest = before; rest != 0; rest &= rest - 1) {
+            g->nbrs[__builtin_ctzll(rest)] |= VERTEX_BIT(j);
+        }
+    }
+    return pos;
+}
+
+
+// Returns the set of vertices in the same component as v
+static inline VertexSet graphComponent (const Graph *g, int v) {
+    // Breadth first search, where each step adds the neighbours of the whole frontier at once
+    VertexSet reached = VERTEX_BIT(v);
+    VertexSet frontier = reached;
+    while (frontier != 0) {
+        VertexSet next = 0;
+        for (VertexSet rest = frontier; rest != 0; rest &= rest - 1) {
+            next |= g->nbrs[__builtin_ctzll(rest)];
+        }
+        frontier = next & ~reached;
+        reached |= frontier;
+    }
+    return reached;
+}
+
+
+// Make h = g/uv: vertex 0 of h is u and v merged into one vertex (adjacent to the neighbours of both), and the
+//  other vertices of g follow it in order
+// Whether u and v are adjacent in g makes no difference
+static inline void graphContractPair (const Graph *g, int u, int v, Graph *h) {
+    int label[BG_MAX_VERTICES];
+    int next = 1;
+    for (int x = 0; x < g->nVerts; x += 1) {
+        if (x == u || x == v) {
+            label[x] = 0;
+        } else {
+            label[x] = next;
+            next += 1;
+        }
+    }
+    graphInit(h, g->nVerts - 1);
+    for (int x = 0; x < g->nVerts; x += 1) {
+        for (VertexSet rest = g->nbrs[x]; rest != 0; rest &= rest - 1) {
+            int y = __builtin_ctzll(rest);
+            if (label[x] != label[y]) {
+                h->nbrs[label[x]] |= VERTEX_BIT(label[y]);
+            }
+        }
+    }
+}
+
+
+// Make h = g[S], the subgraph induced by the set of vertices S (whose vertices keep their order in g)
+static inline void graphInduced (const Graph *g, VertexSet S, Graph *h) {
+    int label[BG_MAX_VERTICES];
+    int next = 0;
+    for (VertexSet rest = S; rest != 0; rest &= rest - 1) {
+        label[__builtin_ctzll(rest)] = next;
+        next += 1;
+    }
+    graphInit(h, next);
+    for (VertexSet rest = S; rest != 0; rest &= rest - 1) {
+        int x = __builtin_ctzll(rest);
+        for (VertexSet nbrs = g->nbrs[x] & S; nbrs != 0; nbrs &= nbrs - 1) {
+            h->nbrs[label[x]] |= VERTEX_BIT(label[__builtin_ctzll(nbrs)]);
+        }
+    }
+}
+
+
+// Print contents of g (for debugging)
+static inline void printGraph (const Graph *g) {
+    printf("Graph on %d vertices:\n", g->nVerts);
+
+    for (int i = 0; i < g->nVerts-1; i += 1) {
+        for (int j = 1; j < g->nVerts; j += 1) {
+            if (j <= i) {
+                printf("  ");
+            } else {
+                printf("%d ", graphHasEdge(g, i, j));
+            }
+        }
+        printf("\n");
+    }
+}
+
+#endif
@@ -0,0 +1,279 @@
+#include <stdlib.h>
+#include <string.h>
+#include "canon.h"
+
+/*
+ * Canonical labelling by individualisation-refinement (see canon.h)
+ *
+ * Partitions are ordered lists of cells, each a VertexSet. Every vertex individualised on the path from the
+ *  root to the current node is recorded in 'chosen', and the partition at each level of that path is kept so
+ *  the search can go back up without redoing the refinement.
+ * Automorphisms come from leaves giving the same graph as the first leaf or the best leaf so far. A leaf
+ *  matching the first leaf maps the subtree it is in onto one already searched completely, so the search jumps
+ *  straight back to the node where its path left the first path. At every node, a child is skipped if some
+ *  known automorphism fixing all the vertices chosen above the node maps an already searched child onto it.
+ */
+
+// Most automorphisms kept for pruning (further ones are dropped, which only makes the search slower)
+#define MAX_AUTOMORPHISMS 128
+
+// Room for the splitters waiting in refine (each split of a cell into k parts adds k of them)
+#define MAX_SPLITTERS (4 * BG_MAX_VERTICES)
+
+typedef struct Partition {
+    VertexSet cells[BG_MAX_VERTICES];
+    int nCells;
+} Partition;
+
+typedef struct Search {
+    const Graph *g;
+    int n;
+    Partition levels[BG_MAX_VERTICES + 1]; // partition at each level of the current path
+    int chosen[BG_MAX_VERTICES];           // vertex individualised at each level of the current path
+    int haveLeaf;                          // 1 once the first leaf has been reached
+    int firstChosen[BG_MAX_VERTICES];      // 'chosen' on the path to the first leaf
+    int firstLabelling[BG_MAX_VERTICES];
+    Graph firstGraph;
+    int bestLabelling[BG_MAX_VERTICES];
+    Graph bestGraph;
+    unsigned char auts[MAX_AUTOMORPHISMS][BG_MAX_VERTICES]; // auts[a][v] is the image of v
+    int nAuts;
+} Search;
+
+
+// Refine p until it is equitable, splitting its cells by the number of neighbours in each of the given splitters
+// (and in the new cells made along the way)
+// 'splitters' needs room for MAX_SPLITTERS sets
+static void refine (const Graph *g, Partition *p, VertexSet *splitters, int nSplitters) {
+    int next = 0;
+    while (next < nSplitters) {
+        VertexSet splitter = splitters[next];
+        next += 1;
+        for (int c = 0; c < p->nCells; c += 1) {
+            VertexSet cell = p->cells[c];
+            if ((cell & (cell - 1)) == 0) {
+                continue;
+            }
+
+            // byCount[k] is the set of vertices of the cell with k neighbours in the splitter (when bit k of 'counts' is set)
+            VertexSet byCount[BG_MAX_VERTICES];
+            uint64_t counts = 0;
+            for (VertexSet rest = cell; rest != 0; rest &= rest - 1) {
+                int v = __builtin_ctzll(rest);
+                int k = __builtin_popcountll(g->nbrs[v] & splitter);
+                if (((counts >> k) & 1) == 0) {
+                    counts |= (uint64_t) 1 << k;
+                    byCount[k] = 0;
+                }
+                byCount[k] |= VERTEX_BIT(v);
+            }
+            if ((counts & (counts - 1)) == 0) {
+                continue;
+            }
+
+            // Replace the cell by its parts, in increasing order of count, and use each part as a splitter
+            int parts = __builtin_popcountll(counts);
+            memmove(&p->cells[c + parts], &p->cells[c + 1], sizeof(VertexSet) * (p->nCells - c - 1));
+            for (int i = c; counts != 0; counts &= counts - 1, i += 1) {
+                p->cells[i] = byCount[__builtin_ctzll(counts)];
+                splitters[nSplitters] = p->cells[i];
+                nSplitters += 1;
+            }
+            p->nCells += parts - 1;
+            c += parts - 1;
+        }
+    }
+}
+
+
+// Returns a negative number, 0 or a positive number as a is smaller than, equal to or larger than b
+static int compareGraphs (const Graph *a, const Graph *b) {
+    for (int v = 0; v < a->nVerts; v += 1) {
+        if (a->nbrs[v] != b->nbrs[v]) {
+            return (a->nbrs[v] < b->nbrs[v]) ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+
+// Record the automorphism taking from[i] to to[i] for each i
+static void addAutomorphism (Search *s, const int *from, const int *to) {
+    if (s->nAuts < MAX_AUTOMORPHISMS) {
+        for (int i = 0; i < s->n; i += 1) {
+            s->auts[s->nAuts][from[i]] = to[i];
+        }
+        s->nAuts += 1;
+    }
+}
+
+
+// Compare the leaf at 'level' with the first and best leaves
+// Returns the level the search should go back to
+static int leaf (Search *s, int level) {
+    const Partition *p = &s->levels[level];
+    int labelling[BG_MAX_VERTICES];
+    int position[BG_MAX_VERTICES];
+    for (int i = 0; i < s->n; i += 1) {
+        labelling[i] = __builtin_ctzll(p->cells[i]);
+        position[labelling[i]] = i;
+    }
+    Graph h;
+    h.nVerts = s->n;
+    for (int i = 0; i < s->n; i += 1) {
+        h.nbrs[i] = 0;
+        for (VertexSet rest = s->g->nbrs[labelling[i]]; rest != 0; rest &= rest - 1) {
+            h.nbrs[i] |= VERTEX_BIT(position[__builtin_ctzll(rest)]);
+        }
+    }
+
+    if (!s->haveLeaf) {
+        s->haveLeaf = 1;
+        memcpy(s->firstChosen, s->chosen, sizeof(int) * level);
+        memcpy(s->firstLabelling, labelling, sizeof(int) * s->n);
+        memcpy(s->bestLabelling, labelling, sizeof(int) * s->n);
+        s->firstGraph = s->bestGraph = h;
+        return level;
+    }
+
+    if (compareGraphs(&h, &s->firstGraph) == 0) {
+        // Go back to where this path left the first one
+        addAutomorphism(s, s->firstLabelling, labelling);
+        int diverged = 0;
+        while (s->chosen[diverged] == s->firstChosen[diverged]) {
+            diverged += 1;
+        }
+        return diverged;
+    }
+    int cmp = compareGraphs(&h, &s->bestGraph);
+    if (cmp == 0) {
+        addAutomorphism(s, s->bestLabelling, labelling);
+    } else if (cmp > 0) {
+        memcpy(s->bestLabelling, labelling, sizeof(int) * s->n);
+        s->bestGraph = h;
+    }
+    return level;
+}
+
+
+// Returns the representative of v's orbit in the union-find forest 'parent'
+static int findOrbit (unsigned char *parent, int v) {
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+
+// Returns 1 if some automorphism found so far which fixes the vertices chosen above 'level' maps a vertex of
+//  'searched' to v (through a chain of such automorphisms), 0 otherwise
+static int inSearchedOrbit (Search *s, int level, int v, VertexSet searched) {
+    unsigned char parent[BG_MAX_VERTICES];
+    for (int u = 0; u < s->n; u += 1) {
+        parent[u] = u;
+    }
+    for (int a = 0; a < s->nAuts; a += 1) {
+        const unsigned char *aut = s->auts[a];
+        int fixes = 1;
+        for (int l = 0; l < level && fixes; l += 1) {
+            fixes = (aut[s->chosen[l]] == s->chosen[l]);
+        }
+        if (!fixes) {
+            continue;
+        }
+        for (int u = 0; u < s->n; u += 1) {
+            int x = findOrbit(parent, u);
+            int y = findOrbit(parent, aut[u]);
+            if (x != y) {
+                parent[x] = y;
+            }
+        }
+    }
+
+    int orbit = findOrbit(parent, v);
+    for (VertexSet rest = searched; rest != 0; rest &= rest - 1) {
+        if (findOrbit(parent, __builtin_ctzll(rest)) == orbit) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+// Search the subtree below the node at 'level' of the current path
+// Returns 'level', or a smaller level if the search should go back up to it
+static int searchNode (Search *s, int level) {
+    const Partition *p = &s->levels[level];
+    if (p->nCells == s->n) {
+        return leaf(s, level);
+    }
+
+    // Individualise each vertex of the first smallest cell with more than one vertex in turn
+    int target = -1;
+    int targetSize = BG_MAX_VERTICES + 1;
+    for (int c = 0; c < p->nCells; c += 1) {
+        int size = __builtin_popcountll(p->cells[c]);
+        if (size > 1 && size < targetSize) {
+            target = c;
+            targetSize = size;
+        }
+    }
+    VertexSet cell = p->cells[target];
+    VertexSet searched = 0;
+    for (VertexSet rest = cell; rest != 0; rest &= rest - 1) {
+        int v = __builtin_ctzll(rest);
+        if (searched != 0 && s->nAuts > 0 && inSearchedOrbit(s, level, v, searched)) {
+            continue;
+        }
+
+        Partition *child = &s->levels[level + 1];
+        memcpy(child->cells, p->cells, sizeof(VertexSet) * target);
+        child->cells[target] = VERTEX_BIT(v);
+        child->cells[target + 1] = cell & ~VERTEX_BIT(v);
+        memcpy(&child->cells[target + 2], &p->cells[target + 1], sizeof(VertexSet) * (p->nCells - target - 1));
+        child->nCells = p->nCells + 1;
+        VertexSet splitters[MAX_SPLITTERS];
+        splitters[0] = VERTEX_BIT(v);
+        refine(s->g, child, splitters, 1);
+
+        s->chosen[level] = v;
+        int back = searchNode(s, level + 1);
+        searched |= VERTEX_BIT(v);
+        if (back < level) {
+            return back;
+        }
+    }
+    return level;
+}
+
+
+void canonicalFormPartitioned (const Graph *g, const VertexSet *cells, int nCells, Graph *canon, int *labelling) {
+    Search *s = (Search*)malloc(sizeof(Search));
+    s->g = g;
+    s->n = g->nVerts;
+    s->haveLeaf = 0;
+    s->nAuts = 0;
+
+    Partition *root = &s->levels[0];
+    root->nCells = nCells;
+    VertexSet splitters[MAX_SPLITTERS];
+    for (int c = 0; c < nCells; c += 1) {
+        root->cells[c] = splitters[c] = cells[c];
+    }
+    refine(g, root, splitters, nCells);
+    searchNode(s, 0);
+
+    *canon = s->bestGraph;
+    canon->nVerts = s->n;
+    if (labelling != NULL) {
+        memcpy(labelling, s->bestLabelling, sizeof(int) * s->n);
+    }
+    free(s);
+}
+
+
+void canonicalForm (const Graph *g, Graph *canon, int *labelling) {
+    VertexSet all = ALL_VERTICES(g->nVerts);
+    canonicalFormPartitioned(g, &all, (g->nVerts > 0) ? 1 : 0, canon, labelling);
+}
@@ -0,0 +1,29 @@
+#ifndef CANON_H
+#define CANON_H
+
+#include "bitgraph.h"
+
+/*
+ * Canonical labelling of small graphs (at most BG_MAX_VERTICES vertices), so that two graphs are isomorphic
+ *  exactly when their canonical forms are identical
+ *
+ * This is a (much simplified) version of the individualisation-refinement search used by nauty. The vertices are
+ *  split into an ordered partition which is refined until it is equitable (every vertex of a cell has the same
+ *  number of neighbours in each cell). If some cell has more than one vertex, each vertex of the first smallest
+ *  such cell is in turn given a cell of its own and the search continues from the refined partition. Each leaf
+ *  of this search tree (a partition into single vertices) is a labelling of the graph, and the canonical form
+ *  is the largest relabelled graph over all leaves. Leaves which give the same graph reveal automorphisms,
+ *  which are used to skip subtrees known to give the same graphs as ones already searched.
+ */
+
+// Relabel g into its canonical form 'canon'
+// If 'labelling' isn't NULL, labelling[i] is set to the vertex of g which became vertex i of canon
+void canonicalForm (const Graph *g, Graph *canon, int *labelling);
+
+// As canonicalForm, for a graph whose vertices are coloured by the (non-empty) cells of the ordered partition
+//  'cells': two graphs get the same canonical form exactly when some isomorphism maps each cell of one to the
+//  same cell of the other. E.g. u and v are in the same orbit of the automorphism group of g exactly when the
+//  partitions {u}, V(g) - u and {v}, V(g) - v give the same form
+void canonicalFormPartitioned (const Graph *g, const VertexSet *cells, int nCells, Graph *canon, int *labelling);
+
+#endif
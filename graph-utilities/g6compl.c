@@ -1,19 +1,27 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "g6pipe.h"
+
+// Uncomment to always use the scalar complement kernel (even when SSE2/AVX2 are available)
+//#define SCALAR_COMPLEMENT
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(SCALAR_COMPLEMENT)
+#include <immintrin.h>
+#define HAVE_X86_VECTORS
+#endif
 
 /*
- * A simple utility which receives a graph (in g6 format) and outputs
- *  the g6 string of the complement graph
+ * A simple utility which receives graphs (in g6 or s6 format, one per line) and outputs
+ *  the g6 string of the complement of each graph
  * See the documentation for g6 format (from B. McKay and A. Piperino's nauty & traces)
  */
 
-#define LINE_MAX_LEN 256
-// I don't know how big a graph has to be before its g6 string exceeds 256 characters
-//  but a quick estimate says that 20 will definitely be safe
-#define MAX_VERTICES 20
-
-// g6 format magic number (see documentation)
-#define G6_START_CHAR 63
+// Optional header at the start of a g6 string (see documentation)
+#define G6_FILE_HEADER ">>graph6<<"
+#define G6_FILE_HEADER_LEN 10
 
 const char ONES[7] = {0,              // 000000
                       32,             // 100000
@@ -24,61 +32,178 @@ const char ONES[7] = {0,              // 000000
                       32+16+8+4+2+1}; // 111111
 
 
-// Returns 1 if the character is a null terminator or a newline character, 0 otherwise
-int isLineEnd(char c) {
-    return (c == 0) || (c == '\n');
+// A full g6 character c = 63 + x becomes 63 + (x ^ 0x3F) = 63 + (63 - x), i.e. COMPLEMENT_SUM - c
+#define COMPLEMENT_SUM (2 * G6_START_CHAR + 0x3F)
+
+
+// Complement all six bits of each of the len characters of 'in', writing them to 'out'
+static void complementCharsScalar (const char *in, char *out, size_t len) {
+    for (size_t i = 0; i < len; i += 1) {
+        out[i] = (char)(COMPLEMENT_SUM - in[i]);
+    }
 }
 
-int main (void) {
 
-    char line[LINE_MAX_LEN+1];
-     // Make sure the string are null terminated
-    line[0] = line[LINE_MAX_LEN] = 0;
+#ifdef HAVE_X86_VECTORS
+// As complementCharsScalar, 16 characters at a time (SSE2)
+static void complementCharsSSE2 (const char *in, char *out, size_t len) {
+    const __m128i sum = _mm_set1_epi8((char) COMPLEMENT_SUM);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i*)&in[i]);
+        _mm_storeu_si128((__m128i*)&out[i], _mm_sub_epi8(sum, chars));
+    }
+    complementCharsScalar(&in[i], &out[i], len - i);
+}
 
-    int numGraphs = 0;
 
-    // Read the line and xor the bit appropriately
-    while(fgets(line, LINE_MAX_LEN, stdin) != NULL) {
-        if (isLineEnd(line[0])) {
-            continue;
-        }
+// As complementCharsScalar, 64 characters at a time (AVX2)
+__attribute__((target("avx2")))
+static void complementCharsAVX2 (const char *in, char *out, size_t len) {
+    const __m256i sum = _mm256_set1_epi8((char) COMPLEMENT_SUM);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i lo = _mm256_loadu_si256((const __m256i*)&in[i]);
+        __m256i hi = _mm256_loadu_si256((const __m256i*)&in[i + 32]);
+        _mm256_storeu_si256((__m256i*)&out[i], _mm256_sub_epi8(sum, lo));
+        _mm256_storeu_si256((__m256i*)&out[i + 32], _mm256_sub_epi8(sum, hi));
+    }
+    for (; i + 32 <= len; i += 32) {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)&in[i]);
+        _mm256_storeu_si256((__m256i*)&out[i], _mm256_sub_epi8(sum, chars));
+    }
+    complementCharsSSE2(&in[i], &out[i], len - i);
+}
+#endif
 
-        int n = line[0] - G6_START_CHAR;
 
-        if (n > MAX_VERTICES) {
-            fprintf(stderr, "ERROR: (g6compl) Found graph with %d vertices (greater than max of %d\n", n , MAX_VERTICES);
-            continue;
-        } else if (n < 0) {
-            fprintf(stderr, "ERROR: (g6compl) Found graph with %d vertices\n", n);
-            continue;
-        }
+// The complement kernel to use (set by chooseComplementKernel)
+static void (*complementChars) (const char *in, char *out, size_t len) = complementCharsScalar;
+
+
+// Pick the fastest complement kernel this CPU supports
+void chooseComplementKernel () {
+#ifdef HAVE_X86_VECTORS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        complementChars = complementCharsAVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        complementChars = complementCharsSSE2;
+    }
+#endif
+}
+
+
+// Write the complement of the graph with g6 string 'text' (of length len) to 'out'
+// Returns G6_OK or one of the error codes in g6io.h
+int complementG6 (const char *text, size_t len, char *out) {
+    size_t prefixLen = 0;
+    if (len >= G6_FILE_HEADER_LEN && memcmp(text, G6_FILE_HEADER, G6_FILE_HEADER_LEN) == 0) {
+        prefixLen = G6_FILE_HEADER_LEN;
+    }
+    long n;
+    int headerLen = g6ParseSize(&text[prefixLen], len - prefixLen, &n);
+    if (headerLen < 0) {
+        return headerLen;
+    }
+    size_t start = prefixLen + headerLen;
+    size_t bits = (size_t) n * (n - 1) / 2;
+    size_t bodyLen = (bits + 5) / 6;
+    if (len - start < bodyLen) {
+        return G6_TOO_SHORT;
+    } else if (len - start > bodyLen) {
+        return G6_TOO_LONG;
+    }
+
+    // Flip every bit of the upper triangle, then put back the padding at the end of the last character
+    memcpy(out, text, start);
+    complementChars(&text[start], &out[start], bodyLen);
+    if (bits % 6 != 0) {
+        out[len - 1] = ((text[len - 1] - G6_START_CHAR) ^ ONES[bits % 6]) + G6_START_CHAR;
+    }
+    return G6_OK;
+}
+
 
-        int bitsLeft = n * (n - 1) / 2;
+// Working memory and counts for each worker thread
+typedef struct State {
+    WideGraph G;
+    long numGraphs;
+} State;
 
-        int linePos = 1;
-        while (!isLineEnd(line[linePos])) {
-            char c = line[linePos] - G6_START_CHAR;
 
-            if (bitsLeft >= 6) {
-                line[linePos] = (c ^ ONES[6]) + G6_START_CHAR;
-                bitsLeft -= 6;
-            } else if (bitsLeft > 0) {
-                line[linePos] = (c ^ ONES[bitsLeft]) + G6_START_CHAR;
-                bitsLeft = 0;
-            } else {
-                fprintf(stderr, "ERROR: (g6compl) Expected graph6 string to end, found %c\n", c);
-            }
+// Write the g6 string of the complement of the graph on the line to 'out'
+void processLine (void *arg, const G6Line *line, G6Out *out) {
+    State *state = (State*)arg;
+    if (line->len == 0) {
+        return;
+    }
 
-            linePos += 1;
+    int err;
+    size_t start = out->len;
+    if (line->text[0] == ':' || (line->len > 2 && line->text[0] == '>' && line->text[2] == 's')) {
+        // s6 (">>sparse6<<" or ':' at the start): decode the graph and write the g6 string of its complement
+        err = g6DecodeWide(line->text, line->len, &state->G);
+        if (err == G6_OK) {
+            wideGraphComplement(&state->G);
+            size_t outLen = g6EncodedLength(state->G.nVerts);
+            char *space = g6OutReserve(out, outLen + 1);
+            g6EncodeWide(&state->G, space);
+            space[outLen] = '\n';
         }
+    } else {
+        // g6: xor the bits appropriately
+        char *space = g6OutReserve(out, line->len + 1);
+        err = complementG6(line->text, line->len, space);
+        space[line->len] = '\n';
+    }
 
-        if (bitsLeft > 0) {
-            fprintf(stderr, "ERROR: (g6compl) reached EOF prematurely, expected %d more bits\n", bitsLeft);
+    if (err != G6_OK) {
+        fprintf(stderr, "ERROR: (g6compl) %s (at byte %zu of the input)\n", g6ErrorString(err), line->offset);
+        out->len = start;
+    } else {
+        state->numGraphs += 1;
+    }
+}
+
+
+int main (int argc, char **argv) {
+    int nThreads = 1;
+    int ordered = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:u")) != -1) {
+        if (opt == 'j' && atoi(optarg) > 0) {
+            nThreads = atoi(optarg);
+        } else if (opt == 'u') {
+            ordered = 0;
         } else {
-            fputs(line, stdout);
-            numGraphs += 1;
+            fprintf(stderr, "Usage: %s [-j threads] [-u] < graphs > complements\n", argv[0]);
+            fprintf(stderr, "  -j threads  number of worker threads (default 1)\n");
+            fprintf(stderr, "  -u          don't keep the graphs in input order (faster with many threads)\n");
+            return 1;
         }
     }
 
-    fprintf(stderr, ">%d graph complements generated\n", numGraphs);
+    chooseComplementKernel();
+
+    State states[nThreads];
+    void *statePtrs[nThreads];
+    for (int t = 0; t < nThreads; t += 1) {
+        wideGraphNew(&states[t].G);
+        states[t].numGraphs = 0;
+        statePtrs[t] = &states[t];
+    }
+
+    int status = g6RunLines(STDIN_FILENO, STDOUT_FILENO, nThreads, ordered, processLine, statePtrs);
+    if (status < 0) {
+        fprintf(stderr, "ERROR: (g6compl) %s\n", strerror(errno));
+    }
+
+    long numGraphs = 0;
+    for (int t = 0; t < nThreads; t += 1) {
+        numGraphs += states[t].numGraphs;
+        wideGraphFree(&states[t].G);
+    }
+    fprintf(stderr, ">%ld graph complements generated\n", numGraphs);
+    return (status < 0) ? 1 : 0;
 }
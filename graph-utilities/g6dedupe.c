@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include "g6pipe.h"
+#include "canon.h"
+
+/*
+ * A utility which receives graphs (in g6 or s6 format, one per line, with at most BG_MAX_VERTICES vertices) and
+ *  outputs one graph from each isomorphism class
+ * Worker threads compute the canonical g6 string of each graph (see canon.h) and pass it on, in input order,
+ *  together with the original line to the main thread. That keeps the canonical strings seen so far in a hash set
+ *  and writes the first graph of each class as soon as it is read (or its canonical string, with -c).
+ * With a memory limit (-m), whenever the set outgrows the limit its strings are sorted and written out to a
+ *  temporary file (a run), and the set starts again empty. At the end all the runs are merged, and each
+ *  canonical string is written once, in sorted order.
+ * See the documentation for g6 format (from B. McKay and A. Piperino's nauty & traces)
+ */
+
+// Uncomment to print the total number of graphs read and the number of classes to stderr once EOF is reached
+// #define PRINT_STATS
+
+// Most characters of a bad line we show in an error message
+#define ERROR_LINE_MAX_LEN 80
+
+// Longest canonical string (the g6 string of a graph on BG_MAX_VERTICES vertices)
+#define MAX_CANON_LEN (4 + (BG_MAX_VERTICES * (BG_MAX_VERTICES - 1) / 2 + 5) / 6)
+
+// Size of the output buffer
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+// Most runs kept at once (when there would be more, they are first merged into one)
+#define MAX_RUNS 64
+
+/*
+ * Hash set of strings
+ *
+ * The strings are stored one after the other in an arena, each as a 2 byte length followed by its characters.
+ *  The table is open addressed, and each slot holds (offset of the string in the arena << 16) | (the top 16
+ *  bits of its hash), or 0 if empty. Offset 0 of the arena is never used so no slot in use is 0.
+ */
+typedef struct StringSet {
+    uint64_t *slots;
+    size_t nSlots; // a power of 2, kept at least twice 'count'
+    size_t count;
+    char *arena;
+    size_t arenaLen;
+    size_t arenaCap;
+} StringSet;
+
+// Working memory for each worker thread
+typedef struct State {
+    WideGraph wide;
+    Graph G;
+    Graph canon;
+} State;
+
+// Arguments of the thread running the workers
+typedef struct Canonicaliser {
+    int outFd;
+    int nThreads;
+    void **states;
+    int status;
+} Canonicaliser;
+
+
+static uint64_t hashString (const char *text, size_t len) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i += 1) {
+        hash = (hash ^ (unsigned char) text[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+void setInit (StringSet *set) {
+    set->nSlots = 1 << 10;
+    set->slots = (uint64_t*)calloc(set->nSlots, sizeof(uint64_t));
+    set->count = 0;
+    set->arenaCap = 1 << 14;
+    set->arena = (char*)malloc(set->arenaCap);
+    set->arenaLen = 1;
+}
+
+
+void setFree (StringSet *set) {
+    free(set->slots);
+    free(set->arena);
+}
+
+
+// Number of bytes used by the set
+size_t setMemory (const StringSet *set) {
+    return sizeof(uint64_t) * set->nSlots + set->arenaCap;
+}
+
+
+static inline const char *setString (const StringSet *set, uint64_t slot, size_t *len) {
+    const unsigned char *entry = (const unsigned char*)&set->arena[slot >> 16];
+    *len = entry[0] | (entry[1] << 8);
+    return (const char*)&entry[2];
+}
+
+
+// Double the number of slots
+static void setGrow (StringSet *set) {
+    size_t nSlots = 2 * set->nSlots;
+    uint64_t *slots = (uint64_t*)calloc(nSlots, sizeof(uint64_t));
+    for (size_t i = 0; i < set->nSlots; i += 1) {
+        if (set->slots[i] != 0) {
+            size_t len;
+            const char *text = setString(set, set->slots[i], &len);
+            size_t pos = hashString(text, len) & (nSlots - 1);
+            while (slots[pos] != 0) {
+                pos = (pos + 1) & (nSlots - 1);
+            }
+            slots[pos] = set->slots[i];
+        }
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->nSlots = nSlots;
+}
+
+
+// Add the string to the set
+// Returns 1 if it was added, 0 if it was already there
+int setInsert (StringSet *set, const char *text, size_t len) {
+    uint64_t hash = hashString(text, len);
+    uint64_t tag = hash >> 48;
+    size_t pos = hash & (set->nSlots - 1);
+    while (set->slots[pos] != 0) {
+        if ((set->slots[pos] & 0xFFFF) == tag) {
+            size_t otherLen;
+            const char *other = setString(set, set->slots[pos], &otherLen);
+            if (otherLen == len && memcmp(other, text, len) == 0) {
+                return 0;
+            }
+        }
+        pos = (pos + 1) & (set->nSlots - 1);
+    }
+
+    if (set->arenaLen + len + 2 > set->arenaCap) {
+        set->arenaCap *= 2;
+        set->arena = (char*)realloc(set->arena, set->arenaCap);
+    }
+    unsigned char *entry = (unsigned char*)&set->arena[set->arenaLen];
+    entry[0] = len & 0xFF;
+    entry[1] = len >> 8;
+    memcpy(&entry[2], text, len);
+    set->slots[pos] = ((uint64_t) set->arenaLen << 16) | tag;
+    set->arenaLen += len + 2;
+    set->count += 1;
+    if (2 * set->count > set->nSlots) {
+        setGrow(set);
+    }
+    return 1;
+}
+
+
+// Order strings as memcmp does, with a string before any longer string it is the start of
+static int compareStrings (const char *a, size_t aLen, const char *b, size_t bLen) {
+    int cmp = memcmp(a, b, (aLen < bLen) ? aLen : bLen);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (aLen < bLen) ? -1 : (aLen > bLen) ? 1 : 0;
+}
+
+
+// The set being sorted by spillSet (qsort has no way to pass it to the comparison)
+static const StringSet *sortingSet;
+
+static int compareSlots (const void *a, const void *b) {
+    size_t aLen, bLen;
+    const char *aText = setString(sortingSet, *(const uint64_t*)a, &aLen);
+    const char *bText = setString(sortingSet, *(const uint64_t*)b, &bLen);
+    return compareStrings(aText, aLen, bText, bLen);
+}
+
+
+// Returns a new temporary file in 'dir' (which is deleted once closed), or NULL (with errno set) on failure
+FILE *openTempFile (const char *dir) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/g6dedupe-XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return NULL;
+    }
+    unlink(path);
+    return fdopen(fd, "w+");
+}
+
+
+// Go back to the start of a run which has just been written
+// Returns 0 on success, or -1 (with errno set, and the run closed) on failure
+int rewindRun (FILE *run) {
+    if (fflush(run) != 0 || fseek(run, 0, SEEK_SET) != 0) {
+        fclose(run);
+        return -1;
+    }
+    return 0;
+}
+
+
+// Write the strings of the set, sorted and one per line, to a new temporary file in 'dir', and empty the set
+// (giving back the memory it grew into)
+// Returns the file (at its start), or NULL (with errno set) on failure
+FILE *spillSet (StringSet *set, const char *dir) {
+    FILE *run = openTempFile(dir);
+    if (run == NULL) {
+        return NULL;
+    }
+
+    uint64_t *sorted = (uint64_t*)malloc(sizeof(uint64_t) * (set->count + 1));
+    size_t count = 0;
+    for (size_t i = 0; i < set->nSlots; i += 1) {
+        if (set->slots[i] != 0) {
+            sorted[count] = set->slots[i];
+            count += 1;
+        }
+    }
+    sortingSet = set;
+    qsort(sorted, count, sizeof(uint64_t), compareSlots);
+    for (size_t i = 0; i < count; i += 1) {
+        size_t len;
+        const char *text = setString(set, sorted[i], &len);
+        fwrite(text, 1, len, run);
+        fputc('\n', run);
+    }
+    free(sorted);
+    setFree(set);
+    setInit(set);
+    return (rewindRun(run) == 0) ? run : NULL;
+}
+
+
+// Merge the sorted runs, writing each string once to 'out'
+// Returns the number of strings written
+long mergeRuns (FILE **runs, int nRuns, FILE *out) {
+    // heads[r] is the next string of run r (or empty once the run is finished)
+    char (*heads)[MAX_CANON_LEN + 2] = malloc(sizeof(*heads) * nRuns);
+    size_t *lens = (size_t*)malloc(sizeof(size_t) * nRuns);
+    int *live = (int*)malloc(sizeof(int) * nRuns);
+    for (int r = 0; r < nRuns; r += 1) {
+        live[r] = (fgets(heads[r], sizeof(heads[r]), runs[r]) != NULL);
+        lens[r] = live[r] ? strcspn(heads[r], "\n") : 0;
+    }
+
+    char last[MAX_CANON_LEN + 2];
+    size_t lastLen = 0;
+    long written = 0;
+    while (1) {
+        int smallest = -1;
+        for (int r = 0; r < nRuns; r += 1) {
+            if (live[r] && (smallest < 0 || compareStrings(heads[r], lens[r], heads[smallest], lens[smallest]) < 0)) {
+                smallest = r;
+            }
+        }
+        if (smallest < 0) {
+            break;
+        }
+        if (written == 0 || compareStrings(heads[smallest], lens[smallest], last, lastLen) != 0) {
+            fwrite(heads[smallest], 1, lens[smallest], out);
+            fputc('\n', out);
+            memcpy(last, heads[smallest], lens[smallest]);
+            lastLen = lens[smallest];
+            written += 1;
+        }
+        live[smallest] = (fgets(heads[smallest], sizeof(heads[smallest]), runs[smallest]) != NULL);
+        lens[smallest] = live[smallest] ? strcspn(heads[smallest], "\n") : 0;
+    }
+
+    free(heads);
+    free(lens);
+    free(live);
+    return written;
+}
+
+
+// Spill the set to a new run, first merging the runs into one if there are already MAX_RUNS of them
+// Returns 0 on success, or -1 (with errno set) on failure
+int addRun (StringSet *set, FILE **runs, int *nRuns, const char *dir) {
+    if (*nRuns == MAX_RUNS) {
+        FILE *merged = openTempFile(dir);
+        if (merged == NULL) {
+            return -1;
+        }
+        mergeRuns(runs, *nRuns, merged);
+        for (int r = 0; r < *nRuns; r += 1) {
+            fclose(runs[r]);
+        }
+        *nRuns = 0;
+        if (rewindRun(merged) < 0) {
+            return -1;
+        }
+        runs[0] = merged;
+        *nRuns = 1;
+    }
+    runs[*nRuns] = spillSet(set, dir);
+    if (runs[*nRuns] == NULL) {
+        return -1;
+    }
+    *nRuns += 1;
+    return 0;
+}
+
+
+// Write the canonical string of the graph on the line, a space and the line itself to 'out'
+void processLine (void *arg, const G6Line *line, G6Out *out) {
+    State *state = (State*)arg;
+    if (line->len == 0) {
+        return;
+    }
+
+    int err = g6DecodeWide(line->text, line->len, &state->wide);
+    if (err == G6_OK && state->wide.nVerts > BG_MAX_VERTICES) {
+        err = G6_TOO_MANY_VERTICES;
+    }
+    if (err != G6_OK) {
+        int shown = (line->len < ERROR_LINE_MAX_LEN) ? line->len : ERROR_LINE_MAX_LEN;
+        fprintf(stderr, "ERROR: (g6dedupe) %s: \"%.*s\"\n", g6ErrorString(err), shown, line->text);
+        return;
+    }
+
+    state->G.nVerts = state->wide.nVerts;
+    for (int v = 0; v < state->G.nVerts; v += 1) {
+        state->G.nbrs[v] = wideGraphRow(&state->wide, v)[0];
+    }
+    canonicalForm(&state->G, &state->canon, NULL);
+
+    size_t canonLen = g6EncodedLength(state->canon.nVerts);
+    char *space = g6OutReserve(out, canonLen + 1 + line->len + 1);
+    g6EncodeGraph(&state->canon, space);
+    space[canonLen] = ' ';
+    memcpy(&space[canonLen + 1], line->text, line->len);
+    space[canonLen + 1 + line->len] = '\n';
+}
+
+
+static void *canonicaliserThread (void *arg) {
+    Canonicaliser *c = (Canonicaliser*)arg;
+    c->status = g6RunLines(STDIN_FILENO, c->outFd, c->nThreads, 1, processLine, c->states);
+    if (c->status < 0) {
+        fprintf(stderr, "ERROR: (g6dedupe) %s\n", strerror(errno));
+    }
+    close(c->outFd);
+    return NULL;
+}
+
+
+int main (int argc, char **argv) {
+    int nThreads = 1;
+    int printCanonical = 0;
+    size_t memoryLimit = 0;
+    const char *tmpDir = (getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp";
+    int opt;
+    while ((opt = getopt(argc, argv, "j:cm:T:")) != -1) {
+        if (opt == 'j' && atoi(optarg) > 0) {
+            nThreads = atoi(optarg);
+        } else if (opt == 'c') {
+            printCanonical = 1;
+        } else if (opt == 'm' && atol(optarg) > 0) {
+            memoryLimit = (size_t) atol(optarg) << 20;
+        } else if (opt == 'T') {
+            tmpDir = optarg;
+        } else {
+            fprintf(stderr, "Usage: %s [-j threads] [-c] [-m megabytes] [-T dir] < graphs > unique-graphs\n", argv[0]);
+            fprintf(stderr, "  -j threads    number of threads computing canonical forms (default 1)\n");
+            fprintf(stderr, "  -c            write the canonical g6 string of each class instead of its first graph\n");
+            fprintf(stderr, "  -m megabytes  limit the memory used for the set of canonical strings, spilling it to\n");
+            fprintf(stderr, "                sorted temporary files when full (the output is then the canonical\n");
+            fprintf(stderr, "                strings in sorted order)\n");
+            fprintf(stderr, "  -T dir        directory for the temporary files (default $TMPDIR or /tmp)\n");
+            return 1;
+        }
+    }
+
+    State *states = (State*)malloc(sizeof(State) * nThreads);
+    void *statePtrs[nThreads];
+    for (int t = 0; t < nThreads; t += 1) {
+        wideGraphNew(&states[t].wide);
+        statePtrs[t] = &states[t];
+    }
+
+    // The workers write to a pipe which we read here (if we stop reading early, their writes fail with EPIPE)
+    signal(SIGPIPE, SIG_IGN);
+    int fds[2];
+    if (pipe(fds) < 0) {
+        fprintf(stderr, "ERROR: (g6dedupe) %s\n", strerror(errno));
+        return 1;
+    }
+    Canonicaliser c = {fds[1], nThreads, statePtrs, 0};
+    pthread_t thread;
+    pthread_create(&thread, NULL, canonicaliserThread, &c);
+
+    static char outBuffer[OUTPUT_BUFFER_SIZE];
+    setvbuf(stdout, outBuffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    StringSet set;
+    setInit(&set);
+    FILE *runs[MAX_RUNS];
+    int nRuns = 0;
+    int status = 0;
+    long totalGraphs = 0;
+    long totalClasses = 0;
+    G6Stream *tagged = g6StreamOpen(fds[0]);
+    G6Line line;
+    int got;
+    while ((got = g6StreamNext(tagged, &line)) > 0) {
+        const char *original = memchr(line.text, ' ', line.len);
+        size_t canonLen = original - line.text;
+        original += 1;
+        totalGraphs += 1;
+        if (!setInsert(&set, line.text, canonLen)) {
+            continue;
+        }
+
+        if (memoryLimit == 0) {
+            if (printCanonical) {
+                fwrite(line.text, 1, canonLen, stdout);
+            } else {
+                fwrite(original, 1, line.len - canonLen - 1, stdout);
+            }
+            fputc('\n', stdout);
+            totalClasses += 1;
+        } else if (setMemory(&set) > memoryLimit && addRun(&set, runs, &nRuns, tmpDir) < 0) {
+            fprintf(stderr, "ERROR: (g6dedupe) Can't write a temporary file in %s: %s\n", tmpDir, strerror(errno));
+            status = -1;
+            break;
+        }
+    }
+    if (got < 0) {
+        fprintf(stderr, "ERROR: (g6dedupe) %s\n", strerror(errno));
+        status = -1;
+    }
+    if (status < 0) {
+        // Unblock the workers if we stopped reading early
+        close(fds[0]);
+        fds[0] = -1;
+    }
+    pthread_join(thread, NULL);
+    if (c.status < 0) {
+        status = -1;
+    }
+
+    if (memoryLimit != 0 && status == 0) {
+        if (addRun(&set, runs, &nRuns, tmpDir) < 0) {
+            fprintf(stderr, "ERROR: (g6dedupe) Can't write a temporary file in %s: %s\n", tmpDir, strerror(errno));
+            status = -1;
+        } else {
+            totalClasses = mergeRuns(runs, nRuns, stdout);
+        }
+    }
+    if (fflush(stdout) != 0) {
+        fprintf(stderr, "ERROR: (g6dedupe) %s\n", strerror(errno));
+        status = -1;
+    }
+
+    for (int r = 0; r < nRuns; r += 1) {
+        fclose(runs[r]);
+    }
+    setFree(&set);
+    g6StreamClose(tagged);
+    if (fds[0] >= 0) {
+        close(fds[0]);
+    }
+    for (int t = 0; t < nThreads; t += 1) {
+        wideGraphFree(&states[t].wide);
+    }
+    free(states);
+    #ifdef PRINT_STATS
+        fprintf(stderr, ">Found %ld isomorphism classes among %ld graphs.\n", totalClasses, totalGraphs);
+    #else
+        (void) totalGraphs;
+        (void) totalClasses;
+    #endif
+    return (status < 0) ? 1 : 0;
+}
@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include "g6pipe.h"
+
+/*
+ * A utility which receives graphs (in g6 or s6 format, one per line), runs each one through a chain of
+ *  filters given on the command line, and outputs the graphs which pass all of them
+ * Each graph is decoded once, and the filters are applied in order to the decoded graph (stopping at the first
+ *  one it fails), so e.g.
+ *      g6filter complement connected
+ *  does the work of g6compl | g6connected with a single parse. Graphs which passed are written as they were
+ *  read, or as the g6 string of the current graph if the chain complemented it.
+ * See the documentation for g6 format (from B. McKay and A. Piperino's nauty & traces)
+ */
+
+// Uncomment to print the total number of graphs read and the number which passed to stderr once EOF is reached
+// #define PRINT_STATS
+
+// Most characters of a bad line we show in an error message
+#define ERROR_LINE_MAX_LEN 80
+
+// Most filters in a chain
+#define MAX_STAGES 64
+
+typedef enum StageType {
+    STAGE_COMPLEMENT,    // replace the graph with its complement (always passes)
+    STAGE_CONNECTED,
+    STAGE_CO_CONNECTED,  // the complement is connected
+    STAGE_BIPARTITE,
+    STAGE_TRIANGLE_FREE,
+    STAGE_MIN_DEGREE,    // minimum degree at least lo
+    STAGE_MAX_DEGREE,    // maximum degree at most hi
+    STAGE_EDGES          // lo <= number of edges <= hi
+} StageType;
+
+typedef struct Stage {
+    StageType type;
+    long lo;
+    long hi;
+} Stage;
+
+// The chain of filters (shared by all the worker threads)
+Stage stages[MAX_STAGES];
+int numStages = 0;
+
+// Working memory and counts for each worker thread
+typedef struct State {
+    WideGraph G;
+    long totalGraphs;
+    long totalPassed;
+} State;
+
+
+// Returns the smallest (if 'largest' is 0) or the largest degree of g (0 for the empty graph)
+long extremeDegree (const WideGraph *g, int largest) {
+    long best = (g->nVerts > 0) ? wideGraphDegree(g, 0) : 0;
+    for (int v = 1; v < g->nVerts; v += 1) {
+        long degree = wideGraphDegree(g, v);
+        if ((largest && degree > best) || (!largest && degree < best)) {
+            best = degree;
+        }
+    }
+    return best;
+}
+
+
+// Apply one filter to g
+// Returns 1 if g passes, 0 otherwise
+int applyStage (const Stage *stage, WideGraph *g) {
+    switch (stage->type) {
+        case STAGE_COMPLEMENT:
+            wideGraphComplement(g);
+            return 1;
+        case STAGE_CONNECTED:
+            return wideGraphIsConnected(g);
+        case STAGE_CO_CONNECTED:
+            return wideGraphIsCoConnected(g);
+        case STAGE_BIPARTITE:
+            return wideGraphIsBipartite(g);
+        case STAGE_TRIANGLE_FREE:
+            return wideGraphIsTriangleFree(g);
+        case STAGE_MIN_DEGREE:
+            return extremeDegree(g, 0) >= stage->lo;
+        case STAGE_MAX_DEGREE:
+            return extremeDegree(g, 1) <= stage->hi;
+        case STAGE_EDGES: {
+            long edges = wideGraphNumEdges(g);
+            return edges >= stage->lo && edges <= stage->hi;
+        }
+    }
+    return 0;
+}
+
+
+// Copy the graph on the line to 'out' if it passes all the filters
+void processLine (void *arg, const G6Line *line, G6Out *out) {
+    State *state = (State*)arg;
+    if (line->len == 0) {
+        return;
+    }
+
+    int err = g6DecodeWide(line->text, line->len, &state->G);
+    if (err != G6_OK) {
+        int shown = (line->len < ERROR_LINE_MAX_LEN) ? line->len : ERROR_LINE_MAX_LEN;
+        fprintf(stderr, "ERROR: (g6filter) %s: \"%.*s\"\n", g6ErrorString(err), shown, line->text);
+        return;
+    }
+    state->totalGraphs += 1;
+
+    int complemented = 0;
+    for (int i = 0; i < numStages; i += 1) {
+        if (!applyStage(&stages[i], &state->G)) {
+            return;
+        }
+        complemented ^= (stages[i].type == STAGE_COMPLEMENT);
+    }
+
+    if (complemented) {
+        size_t outLen = g6EncodedLength(state->G.nVerts);
+        char *space = g6OutReserve(out, outLen + 1);
+        g6EncodeWide(&state->G, space);
+        space[outLen] = '\n';
+    } else {
+        g6OutLine(out, line);
+    }
+    state->totalPassed += 1;
+}
+
+
+// Parse a non-negative number, which must make up all of 'text'
+// Returns the number, or -1 if 'text' isn't one
+long parseCount (const char *text) {
+    char *end;
+    if (*text < '0' || *text > '9') {
+        return -1;
+    }
+    long value = strtol(text, &end, 10);
+    return (*end == '\0') ? value : -1;
+}
+
+
+// Parse a filter given on the command line into 'stage'
+// Returns 0 on success, -1 if 'arg' isn't a filter
+int parseStage (const char *arg, Stage *stage) {
+    const char *value = strchr(arg, '=');
+    size_t nameLen = (value != NULL) ? (size_t)(value - arg) : strlen(arg);
+    value = (value != NULL) ? value + 1 : NULL;
+    stage->lo = 0;
+    stage->hi = -1;
+
+    static const struct { const char *name; StageType type; } PLAIN[] = {
+        {"complement", STAGE_COMPLEMENT},
+        {"connected", STAGE_CONNECTED},
+        {"coconnected", STAGE_CO_CONNECTED},
+        {"bipartite", STAGE_BIPARTITE},
+        {"trianglefree", STAGE_TRIANGLE_FREE}
+    };
+    for (size_t i = 0; i < sizeof(PLAIN) / sizeof(PLAIN[0]); i += 1) {
+        if (value == NULL && strcmp(arg, PLAIN[i].name) == 0) {
+            stage->type = PLAIN[i].type;
+            return 0;
+        }
+    }
+    if (value == NULL) {
+        return -1;
+    }
+
+    if (nameLen == 6 && strncmp(arg, "mindeg", 6) == 0) {
+        stage->type = STAGE_MIN_DEGREE;
+        stage->lo = parseCount(value);
+        return (stage->lo < 0) ? -1 : 0;
+    } else if (nameLen == 6 && strncmp(arg, "maxdeg", 6) == 0) {
+        stage->type = STAGE_MAX_DEGREE;
+        stage->hi = parseCount(value);
+        return (stage->hi < 0) ? -1 : 0;
+    } else if (nameLen == 5 && strncmp(arg, "edges", 5) == 0) {
+        // edges=A (exactly A), edges=A:B, edges=A: (at least A) or edges=:B (at most B)
+        stage->type = STAGE_EDGES;
+        const char *colon = strchr(value, ':');
+        if (colon == NULL) {
+            stage->lo = stage->hi = parseCount(value);
+            return (stage->lo < 0) ? -1 : 0;
+        }
+        char loText[32];
+        size_t loLen = colon - value;
+        if (loLen >= sizeof(loText)) {
+            return -1;
+        }
+        memcpy(loText, value, loLen);
+        loText[loLen] = '\0';
+        stage->lo = (loLen == 0) ? 0 : parseCount(loText);
+        stage->hi = (colon[1] == '\0') ? LONG_MAX : parseCount(&colon[1]);
+        return (stage->lo < 0 || stage->hi < 0) ? -1 : 0;
+    }
+    return -1;
+}
+
+
+void printUsage (const char *name) {
+    fprintf(stderr, "Usage: %s [-j threads] [-u] filter... < graphs > filtered-graphs\n", name);
+    fprintf(stderr, "  -j threads  number of worker threads (default 1)\n");
+    fprintf(stderr, "  -u          don't keep the graphs in input order (faster with many threads)\n");
+    fprintf(stderr, "Filters (applied in order):\n");
+    fprintf(stderr, "  complement    replace the graph with its complement\n");
+    fprintf(stderr, "  connected     keep connected graphs\n");
+    fprintf(stderr, "  coconnected   keep graphs whose complement is connected\n");
+    fprintf(stderr, "  bipartite     keep bipartite graphs\n");
+    fprintf(stderr, "  trianglefree  keep triangle-free graphs\n");
+    fprintf(stderr, "  mindeg=K      keep graphs with minimum degree at least K\n");
+    fprintf(stderr, "  maxdeg=K      keep graphs with maximum degree at most K\n");
+    fprintf(stderr, "  edges=A:B     keep graphs with between A and B edges (A or B may be left out)\n");
+}
+
+
+int main (int argc, char **argv) {
+    int nThreads = 1;
+    int ordered = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:u")) != -1) {
+        if (opt == 'j' && atoi(optarg) > 0) {
+            nThreads = atoi(optarg);
+        } else if (opt == 'u') {
+            ordered = 0;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    for (int i = optind; i < argc; i += 1) {
+        if (numStages == MAX_STAGES) {
+            fprintf(stderr, "ERROR: (g6filter) At most %d filters are allowed\n", MAX_STAGES);
+            return 1;
+        }
+        if (parseStage(argv[i], &stages[numStages]) < 0) {
+            fprintf(stderr, "ERROR: (g6filter) Unknown filter \"%s\"\n", argv[i]);
+            printUsage(argv[0]);
+            return 1;
+        }
+        numStages += 1;
+    }
+
+    State states[nThreads];
+    void *statePtrs[nThreads];
+    for (int t = 0; t < nThreads; t += 1) {
+        wideGraphNew(&states[t].G);
+        states[t].totalGraphs = states[t].totalPassed = 0;
+        statePtrs[t] = &states[t];
+    }
+
+    int status = g6RunLines(STDIN_FILENO, STDOUT_FILENO, nThreads, ordered, processLine, statePtrs);
+    if (status < 0) {
+        fprintf(stderr, "ERROR: (g6filter) %s\n", strerror(errno));
+    }
+
+    long totalGraphs = 0;
+    long totalPassed = 0;
+    for (int t = 0; t < nThreads; t += 1) {
+        totalGraphs += states[t].totalGraphs;
+        totalPassed += states[t].totalPassed;
+        wideGraphFree(&states[t].G);
+    }
+    #ifdef PRINT_STATS
+        fprintf(stderr, ">%ld of %ld graphs passed the filters.\n", totalPassed, totalGraphs);
+    #else
+        (void) totalGraphs;
+        (void) totalPassed;
+    #endif
+    return (status < 0) ? 1 : 0;
+}
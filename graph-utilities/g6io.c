@@ -0,0 +1,482 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "g6io.h"
+
+/*
+ * Input layer for files of g6 strings (see g6io.h)
+ */
+
+// Size of the blocks we read when a file can't be mapped
+#define READ_BLOCK_SIZE (1 << 20)
+
+// Size of the blocks a G6Stream reads
+#define STREAM_BLOCK_SIZE (1 << 20)
+
+// Optional headers at the start of a g6 or s6 file (see documentation)
+#define G6_FILE_HEADER ">>graph6<<"
+#define G6_FILE_HEADER_LEN 10
+#define S6_FILE_HEADER ">>sparse6<<"
+#define S6_FILE_HEADER_LEN 11
+
+
+// Read everything from fd into a malloc'd buffer
+// Returns 0 on success, -1 (with errno set) on failure
+static int readWholeFile (int fd, G6File *f) {
+    size_t cap = READ_BLOCK_SIZE;
+    char *data = (char*)malloc(cap);
+    size_t size = 0;
+    while (1) {
+        if (cap - size < READ_BLOCK_SIZE) {
+            cap *= 2;
+            data = (char*)realloc(data, cap);
+        }
+        ssize_t got = read(fd, &data[size], READ_BLOCK_SIZE);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(data);
+            return -1;
+        } else if (got == 0) {
+            break;
+        }
+        size += got;
+    }
+    f->data = data;
+    f->size = size;
+    f->mapped = 0;
+    return 0;
+}
+
+
+G6File *g6Open (const char *path) {
+    int fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    G6File *f = (G6File*)malloc(sizeof(G6File));
+    struct stat info;
+    int ok = 0;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            f->data = (const char*)data;
+            f->size = info.st_size;
+            f->mapped = 1;
+            ok = 1;
+        }
+    }
+    if (!ok && readWholeFile(fd, f) < 0) {
+        int err = errno;
+        free(f);
+        f = NULL;
+        errno = err;
+    }
+
+    if (fd != STDIN_FILENO) {
+        close(fd); // The mapping stays valid
+    }
+    return f;
+}
+
+
+void g6Close (G6File *f) {
+    if (f->mapped) {
+        munmap((void*)f->data, f->size);
+    } else {
+        free((void*)f->data);
+    }
+    free(f);
+}
+
+
+void g6CursorInit (const G6File *f, size_t start, size_t end, G6Cursor *cur) {
+    cur->data = f->data;
+    cur->pos = start;
+    cur->end = end;
+}
+
+
+int g6NextLine (G6Cursor *cur, G6Line *line) {
+    if (cur->pos >= cur->end) {
+        return 0;
+    }
+    const char *start = &cur->data[cur->pos];
+    const char *newline = memchr(start, '\n', cur->end - cur->pos);
+    size_t len = (newline != NULL) ? (size_t)(newline - start) : cur->end - cur->pos;
+
+    line->text = start;
+    line->offset = cur->pos;
+    line->len = (len > 0 && start[len - 1] == '\r') ? len - 1 : len;
+    cur->pos += (newline != NULL) ? len + 1 : len;
+    return 1;
+}
+
+
+size_t g6LineStart (const G6File *f, size_t offset) {
+    if (offset == 0) {
+        return 0;
+    } else if (offset >= f->size) {
+        return f->size;
+    }
+    // offset starts a line exactly when the previous character is a newline
+    const char *newline = memchr(&f->data[offset - 1], '\n', f->size - offset + 1);
+    return (newline != NULL) ? (size_t)(newline - f->data) + 1 : f->size;
+}
+
+
+size_t g6CountLines (const G6File *f, size_t start, size_t end) {
+    size_t count = 0;
+    const char *pos = &f->data[start];
+    const char *stop = &f->data[end];
+    while (pos < stop) {
+        const char *newline = memchr(pos, '\n', stop - pos);
+        count += 1;
+        if (newline == NULL) {
+            break;
+        }
+        pos = newline + 1;
+    }
+    return count;
+}
+
+
+void g6SplitFile (const G6File *f, int nShards, size_t *bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < nShards; i += 1) {
+        size_t target = g6LineStart(f, (f->size / nShards) * i);
+        bounds[i] = (target > bounds[i - 1]) ? target : bounds[i - 1];
+    }
+    bounds[nShards] = f->size;
+}
+
+
+int g6ParseSize (const char *text, size_t len, long *n) {
+    // Numbers of vertices up to 62 take one character, up to 258047 take '~' and three characters,
+    //  and anything larger takes "~~" and six characters (six bits per character)
+    int headerLen, first;
+    if (len >= 1 && text[0] != '~') {
+        headerLen = 1;
+        first = 0;
+    } else if (len >= 2 && text[1] != '~') {
+        headerLen = 4;
+        first = 1;
+    } else {
+        headerLen = 8;
+        first = 2;
+    }
+    if (len < (size_t) headerLen) {
+        return G6_BAD_HEADER;
+    }
+
+    long value = 0;
+    for (int i = first; i < headerLen; i += 1) {
+        int c = text[i] - G6_START_CHAR;
+        if (c < 0 || c > 63) {
+            return G6_BAD_HEADER;
+        }
+        value = (value << 6) | c;
+    }
+    *n = value;
+    return headerLen;
+}
+
+
+int g6DecodeGraph (const char *text, size_t len, Graph *g) {
+    if (len >= G6_FILE_HEADER_LEN && memcmp(text, G6_FILE_HEADER, G6_FILE_HEADER_LEN) == 0) {
+        text += G6_FILE_HEADER_LEN;
+        len -= G6_FILE_HEADER_LEN;
+    }
+
+    long n;
+    int headerLen = g6ParseSize(text, len, &n);
+    if (headerLen < 0) {
+        return headerLen;
+    } else if (n > BG_MAX_VERTICES) {
+        return G6_TOO_MANY_VERTICES;
+    }
+
+    g->nVerts = n;
+    int bodyLen = g6DecodeBody(&text[headerLen], len - headerLen, g);
+    if (bodyLen < 0) {
+        return G6_TOO_SHORT;
+    } else if ((size_t)(headerLen + bodyLen) < len) {
+        return G6_TOO_LONG;
+    }
+    return G6_OK;
+}
+
+
+// Take the next 'count' bits (at most 32) from a stream of 6-bit characters, most significant first
+// 'buf' holds the bufBits bits read but not yet taken, and 'pos' is the next character to read
+// Returns the bits, or -1 if the text ends first
+static inline int64_t takeBits (const char *text, size_t len, size_t *pos, uint64_t *buf, int *bufBits, int count) {
+    while (*bufBits < count) {
+        if (*pos >= len) {
+            return -1;
+        }
+        *buf = (*buf << 6) | ((text[*pos] - G6_START_CHAR) & 0x3F);
+        *bufBits += 6;
+        *pos += 1;
+    }
+    *bufBits -= count;
+    return (*buf >> *bufBits) & (((uint64_t) 1 << count) - 1);
+}
+
+
+// Decode the body of a g6 string (after the number of vertices) into g, which has g->nVerts vertices and no edges
+// The body must be exactly the right length
+static void decodeWideBody (const char *body, size_t len, WideGraph *g) {
+    // Column j of the upper triangle is the next j bits, which we take 32 at a time (see g6DecodeBody)
+    uint64_t buf = 0;
+    int bufBits = 0;
+    size_t pos = 0;
+    for (int j = 1; j < g->nVerts; j += 1) {
+        uint64_t *row = wideGraphRow(g, j);
+        for (int first = 0; first < j; first += 32) {
+            int count = (j - first < 32) ? j - first : 32;
+            uint32_t bits = takeBits(body, len, &pos, &buf, &bufBits, count);
+            uint64_t before = (uint64_t)(reverseBits32(bits) >> (32 - count)) << (first % 64);
+            row[first / 64] |= before;
+            for (uint64_t rest = before; rest != 0; rest &= rest - 1) {
+                wideGraphRow(g, 64 * (first / 64) + __builtin_ctzll(rest))[j / 64] |= (uint64_t) 1 << (j % 64);
+            }
+        }
+    }
+}
+
+
+// Decode the body of an s6 string (after the number of vertices) into g, which has g->nVerts vertices and no edges
+// Returns G6_OK or G6_BAD_CHARACTER
+static int decodeSparseBody (const char *body, size_t len, WideGraph *g) {
+    long n = g->nVerts;
+    for (size_t i = 0; i < len; i += 1) {
+        if (body[i] < G6_START_CHAR || body[i] > G6_START_CHAR + 63) {
+            return G6_BAD_CHARACTER;
+        }
+    }
+
+    // Each edge (or jump) is a bit b followed by a k bit number x, where k is the number of bits of n - 1
+    //  (see documentation); an incomplete pair at the end is padding
+    int k = 0;
+    for (long x = n - 1; x > 0; x >>= 1) {
+        k += 1;
+    }
+    uint64_t buf = 0;
+    int bufBits = 0;
+    size_t pos = 0;
+    long v = 0;
+    while (1) {
+        int64_t b = takeBits(body, len, &pos, &buf, &bufBits, 1);
+        int64_t x = (b < 0) ? -1 : takeBits(body, len, &pos, &buf, &bufBits, k);
+        if (x < 0) {
+            break;
+        }
+        v += b;
+        if (v >= n) {
+            break;
+        } else if (x > v) {
+            v = x;
+        } else {
+            wideGraphAddEdge(g, x, v);
+        }
+    }
+    return G6_OK;
+}
+
+
+int g6DecodeWide (const char *text, size_t len, WideGraph *g) {
+    if (len >= G6_FILE_HEADER_LEN && memcmp(text, G6_FILE_HEADER, G6_FILE_HEADER_LEN) == 0) {
+        text += G6_FILE_HEADER_LEN;
+        len -= G6_FILE_HEADER_LEN;
+    } else if (len >= S6_FILE_HEADER_LEN && memcmp(text, S6_FILE_HEADER, S6_FILE_HEADER_LEN) == 0) {
+        text += S6_FILE_HEADER_LEN;
+        len -= S6_FILE_HEADER_LEN;
+    }
+    int sparse = (len >= 1 && text[0] == ':');
+    if (sparse) {
+        text += 1;
+        len -= 1;
+    }
+
+    long n;
+    int headerLen = g6ParseSize(text, len, &n);
+    if (headerLen < 0) {
+        return headerLen;
+    } else if (n > WIDE_MAX_VERTICES) {
+        return G6_TOO_MANY_VERTICES;
+    }
+    const char *body = &text[headerLen];
+    size_t bodyLen = len - headerLen;
+
+    if (sparse) {
+        wideGraphInit(g, n);
+        return decodeSparseBody(body, bodyLen, g);
+    }
+    // Check the length before allocating anything, in case n is nonsense
+    size_t needed = ((size_t) n * (n - 1) / 2 + 5) / 6;
+    if (bodyLen < needed) {
+        return G6_TOO_SHORT;
+    } else if (bodyLen > needed) {
+        return G6_TOO_LONG;
+    }
+    wideGraphInit(g, n);
+    decodeWideBody(body, bodyLen, g);
+    return G6_OK;
+}
+
+
+size_t g6EncodedLength (long n) {
+    int headerLen = (n <= 62) ? 1 : (n <= 258047) ? 4 : 8;
+    return headerLen + ((size_t) n * (n - 1) / 2 + 5) / 6;
+}
+
+
+// Write the number of vertices n at the start of a g6 string
+// Returns the number of characters written
+static int encodeSize (long n, char *text) {
+    int pos = 0;
+    if (n <= 62) {
+        text[pos++] = n + G6_START_CHAR;
+    } else {
+        int digits = (n <= 258047) ? 3 : 6;
+        text[pos++] = '~';
+        if (digits == 6) {
+            text[pos++] = '~';
+        }
+        for (int d = digits - 1; d >= 0; d -= 1) {
+            text[pos++] = ((n >> (6 * d)) & 0x3F) + G6_START_CHAR;
+        }
+    }
+    return pos;
+}
+
+
+void g6EncodeWide (const WideGraph *g, char *text) {
+    long n = g->nVerts;
+    size_t pos = encodeSize(n, text);
+
+    int c = 0, bits = 0;
+    for (int j = 1; j < n; j += 1) {
+        const uint64_t *row = wideGraphRow(g, j);
+        for (int i = 0; i < j; i += 1) {
+            c = (c << 1) | ((row[i / 64] >> (i % 64)) & 1);
+            bits += 1;
+            if (bits == 6) {
+                text[pos++] = c + G6_START_CHAR;
+                c = bits = 0;
+            }
+        }
+    }
+    if (bits > 0) {
+        text[pos++] = (c << (6 - bits)) + G6_START_CHAR;
+    }
+}
+
+
+void g6EncodeGraph (const Graph *g, char *text) {
+    int n = g->nVerts;
+    size_t pos = encodeSize(n, text);
+
+    int c = 0, bits = 0;
+    for (int j = 1; j < n; j += 1) {
+        for (int i = 0; i < j; i += 1) {
+            c = (c << 1) | graphHasEdge(g, i, j);
+            bits += 1;
+            if (bits == 6) {
+                text[pos++] = c + G6_START_CHAR;
+                c = bits = 0;
+            }
+        }
+    }
+    if (bits > 0) {
+        text[pos++] = (c << (6 - bits)) + G6_START_CHAR;
+    }
+}
+
+
+G6Stream *g6StreamOpen (int fd) {
+    G6Stream *s = (G6Stream*)malloc(sizeof(G6Stream));
+    s->fd = fd;
+    s->cap = 2 * STREAM_BLOCK_SIZE;
+    s->buf = (char*)malloc(s->cap);
+    s->start = s->end = s->consumed = 0;
+    s->atEnd = 0;
+    return s;
+}
+
+
+void g6StreamClose (G6Stream *s) {
+    free(s->buf);
+    free(s);
+}
+
+
+int g6StreamNext (G6Stream *s, G6Line *line) {
+    size_t searched = s->start; // everything in [start, searched) is known not to be a newline
+    while (1) {
+        char *newline = memchr(&s->buf[searched], '\n', s->end - searched);
+        size_t lineEnd = (newline != NULL) ? (size_t)(newline - s->buf) : s->end;
+        if (newline != NULL || (s->atEnd && s->start < s->end)) {
+            size_t len = lineEnd - s->start;
+            line->text = &s->buf[s->start];
+            line->offset = s->consumed + s->start;
+            line->len = (len > 0 && line->text[len - 1] == '\r') ? len - 1 : len;
+            s->start = (newline != NULL) ? lineEnd + 1 : lineEnd;
+            return 1;
+        } else if (s->atEnd) {
+            return 0;
+        }
+
+        // Keep the start of the line and read some more (making room if the line is very long)
+        searched = s->end - s->start;
+        if (s->start > 0) {
+            memmove(s->buf, &s->buf[s->start], s->end - s->start);
+            s->consumed += s->start;
+            s->end -= s->start;
+            s->start = 0;
+        }
+        if (s->cap - s->end < STREAM_BLOCK_SIZE) {
+            s->cap *= 2;
+            s->buf = (char*)realloc(s->buf, s->cap);
+        }
+        ssize_t got = read(s->fd, &s->buf[s->end], s->cap - s->end);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        } else if (got == 0) {
+            s->atEnd = 1;
+        }
+        s->end += got;
+    }
+}
+
+
+const char *g6ErrorString (int err) {
+    switch (err) {
+        case G6_OK:
+            return "no error";
+        case G6_BAD_HEADER:
+            return "invalid number of vertices";
+        case G6_TOO_SHORT:
+            return "g6 string ended prematurely";
+        case G6_TOO_LONG:
+            return "g6 string is too long";
+        case G6_TOO_MANY_VERTICES:
+            return "graph has too many vertices";
+        case G6_BAD_CHARACTER:
+            return "invalid character in s6 string";
+        default:
+            return "unknown error";
+    }
+}
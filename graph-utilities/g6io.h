@@ -0,0 +1,120 @@
+#ifndef G6IO_H
+#define G6IO_H
+
+#include <stddef.h>
+#include "bitgraph.h"
+#include "widegraph.h"
+
+/*
+ * Input layer for files of g6 strings (one graph per line)
+ *
+ * A G6File holds the whole file in memory: it is mapped with mmap when possible and otherwise (pipes and
+ *  other files which can't be mapped) read in large blocks. Lines are handed out as pointers into that
+ *  memory, so nothing is copied per line. A G6Cursor walks through the lines in a byte range of the file,
+ *  and g6SplitFile cuts the file into ranges on line boundaries so each range can be read independently.
+ * For input which should be read as it arrives (e.g. the output of geng through a pipe), a G6Stream reads
+ *  from a file descriptor in large blocks and hands out lines of any length.
+ * Graphs can be decoded into a Graph (at most BG_MAX_VERTICES vertices, g6 only) or a WideGraph (any size,
+ *  from g6 or s6).
+ * See the documentation for g6 and s6 formats (from B. McKay and A. Piperino's nauty & traces)
+ */
+
+// Error codes returned by g6ParseSize and g6DecodeGraph
+#define G6_OK 0
+#define G6_BAD_HEADER -1        // the line doesn't start with a valid number of vertices
+#define G6_TOO_SHORT -2         // the line ended before all the edges were read
+#define G6_TOO_LONG -3          // there are characters left over after the edges
+#define G6_TOO_MANY_VERTICES -4 // the graph is too big for the Graph type (or WIDE_MAX_VERTICES for a WideGraph)
+#define G6_BAD_CHARACTER -5     // an s6 string contains a character which can't be part of one
+
+// Largest number of vertices we decode into a WideGraph (which takes n^2 / 8 bytes)
+#define WIDE_MAX_VERTICES (1 << 17)
+
+typedef struct G6File {
+    const char *data;
+    size_t size;
+    int mapped; // 1 if data is mapped from the file, 0 if it was read into a malloc'd buffer
+} G6File;
+
+typedef struct G6Cursor {
+    const char *data;
+    size_t pos; // offset of the next line
+    size_t end; // offset just past the last line
+} G6Cursor;
+
+typedef struct G6Line {
+    const char *text; // points into the file (so it is not null terminated)
+    size_t len;       // not counting the line ending
+    size_t offset;    // byte offset of the line in the file
+} G6Line;
+
+typedef struct G6Stream {
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t start;    // unread data is buf[start, end)
+    size_t end;
+    size_t consumed; // offset in the input of buf[0]
+    int atEnd;       // 1 once read has returned 0
+} G6Stream;
+
+
+// Open the file at 'path' (or standard input if path is "-")
+// Returns NULL (with errno set) on failure
+G6File *g6Open (const char *path);
+
+void g6Close (G6File *f);
+
+// Make 'cur' walk through the lines starting in the byte range [start, end) of f
+// (start should be the start of a line, see g6LineStart)
+void g6CursorInit (const G6File *f, size_t start, size_t end, G6Cursor *cur);
+
+// Store the next line of 'cur' in 'line'
+// Returns 1 if there was a line, 0 at the end of the range
+int g6NextLine (G6Cursor *cur, G6Line *line);
+
+// Returns the offset of the first line which starts at or after 'offset'
+size_t g6LineStart (const G6File *f, size_t offset);
+
+// Returns the number of lines starting in the byte range [start, end) of f
+size_t g6CountLines (const G6File *f, size_t start, size_t end);
+
+// Split f into nShards ranges of about the same size, each starting at the start of a line
+// Range i is [bounds[i], bounds[i+1]) (so 'bounds' must have nShards + 1 entries)
+void g6SplitFile (const G6File *f, int nShards, size_t *bounds);
+
+// Read the number of vertices at the start of a g6 string of length len into *n
+// Returns the number of characters used (1, 4 or 8), or G6_BAD_HEADER
+int g6ParseSize (const char *text, size_t len, long *n);
+
+// Decode the g6 string 'text' (of length len, without its line ending) into g
+// Returns G6_OK or one of the error codes above
+int g6DecodeGraph (const char *text, size_t len, Graph *g);
+
+// Decode the g6 or s6 string 'text' (of length len, without its line ending) into g
+// Returns G6_OK or one of the error codes above
+int g6DecodeWide (const char *text, size_t len, WideGraph *g);
+
+// Returns the length of the g6 string of a graph on n vertices
+size_t g6EncodedLength (long n);
+
+// Write the g6 string of g (without a line ending) to 'text', which must have g6EncodedLength(g->nVerts) characters
+void g6EncodeWide (const WideGraph *g, char *text);
+
+// As g6EncodeWide, for a Graph
+void g6EncodeGraph (const Graph *g, char *text);
+
+// Start reading lines from the file descriptor fd
+G6Stream *g6StreamOpen (int fd);
+
+// Free s (without closing its file descriptor)
+void g6StreamClose (G6Stream *s);
+
+// Store the next line of s in 'line' (which stays valid until the next call)
+// Returns 1 if there was a line, 0 at the end of the input, and -1 (with errno set) if reading failed
+int g6StreamNext (G6Stream *s, G6Line *line);
+
+// Returns a description of one of the error codes above
+const char *g6ErrorString (int err);
+
+#endif
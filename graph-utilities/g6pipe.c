@@ -0,0 +1,301 @@
+#define _GNU_SOURCE // for memrchr
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include "g6pipe.h"
+
+/*
+ * Parallel driver for the line-by-line graph tools (see g6pipe.h)
+ *
+ * Chunks live in a pool of nChunks. The reader takes a free chunk, fills it and gives it the next sequence number;
+ *  chunk number i is kept in bySeq[i % nChunks] until it is written (at most nChunks are in flight, so these
+ *  don't collide). Chunks [nextWork, nextRead) are waiting for a worker, and in ordered mode the writer waits for
+ *  chunk nextWrite to be done. Written chunks go back on the free list.
+ */
+
+// Number of bytes read into each chunk (a chunk grows if a single line doesn't fit)
+#define CHUNK_SIZE (4 << 20)
+// Number of chunks in flight for each worker thread
+#define CHUNKS_PER_THREAD 3
+
+typedef struct Chunk {
+    char *data;
+    size_t len;
+    size_t cap;
+    size_t offset; // offset of data[0] in the whole input
+    int done;      // 1 once a worker has finished with the chunk
+    G6Out out;
+} Chunk;
+
+typedef struct Pipe {
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // signalled whenever any of the fields below change
+    pthread_mutex_t writeLock; // held while writing a chunk's output, so that chunks don't get mixed up
+    Chunk *chunks;
+    int nChunks;
+    Chunk **free;
+    int nFree;
+    Chunk **bySeq;
+    long nextRead;
+    long nextWork;
+    long nextWrite;
+    int doneReading;
+    int ordered;
+    int outFd;
+    int writeError; // errno of the first failed write (0 if none)
+    G6LineFn fn;
+} Pipe;
+
+typedef struct Worker {
+    Pipe *pipe;
+    void *state;
+} Worker;
+
+
+// Write all of text to fd
+// Returns 0 on success, or an errno value
+static int writeAll (int fd, const char *text, size_t len) {
+    while (len > 0) {
+        ssize_t done = write(fd, text, len);
+        if (done < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        text += done;
+        len -= done;
+    }
+    return 0;
+}
+
+
+// Write the output of chunk and put it back on the free list
+// Assumes we don't hold the lock
+static void finishChunk (Pipe *p, Chunk *chunk) {
+    // In unordered mode the workers write at the same time, and writes this big to a pipe can be split up
+    pthread_mutex_lock(&p->writeLock);
+    int err = writeAll(p->outFd, chunk->out.text, chunk->out.len);
+    pthread_mutex_unlock(&p->writeLock);
+
+    pthread_mutex_lock(&p->lock);
+    if (err != 0 && p->writeError == 0) {
+        p->writeError = err;
+    }
+    chunk->done = 0;
+    p->free[p->nFree] = chunk;
+    p->nFree += 1;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+
+static void *workerThread (void *arg) {
+    Worker *worker = (Worker*)arg;
+    Pipe *p = worker->pipe;
+
+    pthread_mutex_lock(&p->lock);
+    while (1) {
+        while (p->nextWork == p->nextRead && !p->doneReading) {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        if (p->nextWork == p->nextRead) {
+            break; // Nothing left to read
+        }
+        Chunk *chunk = p->bySeq[p->nextWork % p->nChunks];
+        p->nextWork += 1;
+        pthread_mutex_unlock(&p->lock);
+
+        chunk->out.len = 0;
+        G6Cursor cur = {chunk->data, 0, chunk->len};
+        G6Line line;
+        while (g6NextLine(&cur, &line)) {
+            line.offset += chunk->offset;
+            p->fn(worker->state, &line, &chunk->out);
+        }
+
+        if (p->ordered) {
+            pthread_mutex_lock(&p->lock);
+            chunk->done = 1;
+            pthread_cond_broadcast(&p->changed);
+        } else {
+            finishChunk(p, chunk);
+            pthread_mutex_lock(&p->lock);
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+
+static void *writerThread (void *arg) {
+    Pipe *p = (Pipe*)arg;
+
+    pthread_mutex_lock(&p->lock);
+    while (1) {
+        while (!(p->nextWrite < p->nextRead && p->bySeq[p->nextWrite % p->nChunks]->done)
+                && !(p->doneReading && p->nextWrite == p->nextRead)) {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        if (p->nextWrite == p->nextRead) {
+            break; // Everything has been read and written
+        }
+        Chunk *chunk = p->bySeq[p->nextWrite % p->nChunks];
+        p->nextWrite += 1;
+        pthread_mutex_unlock(&p->lock);
+
+        finishChunk(p, chunk);
+        pthread_mutex_lock(&p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+
+// Fill chunk with the input up to the end of a line, after the 'carry' characters already at its start
+// Returns the number of characters after the last newline (to carry over to the next chunk), or -1 on error
+// Sets *atEnd once the input is exhausted (in which case nothing is carried over)
+static long fillChunk (int fd, Chunk *chunk, size_t carry, int *atEnd) {
+    chunk->len = carry;
+    while (1) {
+        if (chunk->cap - chunk->len < CHUNK_SIZE / 2) {
+            // Only happens when a line is longer than half a chunk
+            chunk->cap *= 2;
+            chunk->data = (char*)realloc(chunk->data, chunk->cap);
+        }
+        while (chunk->len < chunk->cap && !*atEnd) {
+            ssize_t got = read(fd, &chunk->data[chunk->len], chunk->cap - chunk->len);
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            *atEnd = (got == 0);
+            chunk->len += got;
+        }
+        if (*atEnd) {
+            return 0;
+        }
+        const char *lastNewline = memrchr(&chunk->data[carry], '\n', chunk->len - carry);
+        if (lastNewline != NULL) {
+            size_t used = lastNewline - chunk->data + 1;
+            long rest = chunk->len - used;
+            chunk->len = used;
+            return rest;
+        }
+        carry = chunk->len; // No newline yet, so keep reading
+    }
+}
+
+
+int g6RunLines (int inFd, int outFd, int nThreads, int ordered, G6LineFn fn, void **states) {
+    Pipe p;
+    p.nChunks = CHUNKS_PER_THREAD * nThreads + 1;
+    p.chunks = (Chunk*)malloc(sizeof(Chunk) * p.nChunks);
+    p.free = (Chunk**)malloc(sizeof(Chunk*) * p.nChunks);
+    p.bySeq = (Chunk**)malloc(sizeof(Chunk*) * p.nChunks);
+    for (int i = 0; i < p.nChunks; i += 1) {
+        p.chunks[i].cap = CHUNK_SIZE;
+        p.chunks[i].data = (char*)malloc(CHUNK_SIZE);
+        p.chunks[i].done = 0;
+        p.chunks[i].out.cap = CHUNK_SIZE;
+        p.chunks[i].out.len = 0;
+        p.chunks[i].out.text = (char*)malloc(CHUNK_SIZE);
+        p.free[i] = &p.chunks[i];
+    }
+    p.nFree = p.nChunks;
+    p.nextRead = p.nextWork = p.nextWrite = 0;
+    p.doneReading = 0;
+    p.ordered = ordered;
+    p.outFd = outFd;
+    p.writeError = 0;
+    p.fn = fn;
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.changed, NULL);
+    pthread_mutex_init(&p.writeLock, NULL);
+
+    pthread_t threads[nThreads];
+    Worker workers[nThreads];
+    pthread_t writer;
+    for (int t = 0; t < nThreads; t += 1) {
+        workers[t].pipe = &p;
+        workers[t].state = states[t];
+        pthread_create(&threads[t], NULL, workerThread, &workers[t]);
+    }
+    if (ordered) {
+        pthread_create(&writer, NULL, writerThread, &p);
+    }
+
+    // Characters after the last newline of the previous chunk
+    char *carried = (char*)malloc(CHUNK_SIZE);
+    size_t carriedLen = 0, carriedCap = CHUNK_SIZE;
+    size_t offset = 0;
+    int atEnd = 0;
+    int readError = 0;
+    while (!atEnd) {
+        pthread_mutex_lock(&p.lock);
+        while (p.nFree == 0) {
+            pthread_cond_wait(&p.changed, &p.lock);
+        }
+        p.nFree -= 1;
+        Chunk *chunk = p.free[p.nFree];
+        pthread_mutex_unlock(&p.lock);
+
+        if (carriedLen > chunk->cap) {
+            chunk->cap = carriedLen;
+            chunk->data = (char*)realloc(chunk->data, chunk->cap);
+        }
+        memcpy(chunk->data, carried, carriedLen);
+        long rest = fillChunk(inFd, chunk, carriedLen, &atEnd);
+        if (rest < 0) {
+            readError = errno;
+            atEnd = 1;
+            rest = 0;
+        }
+        if ((size_t) rest > carriedCap) {
+            carriedCap = rest;
+            carried = (char*)realloc(carried, carriedCap);
+        }
+        memcpy(carried, &chunk->data[chunk->len], rest);
+        carriedLen = rest;
+        chunk->offset = offset;
+        offset += chunk->len;
+
+        pthread_mutex_lock(&p.lock);
+        if (chunk->len > 0) {
+            p.bySeq[p.nextRead % p.nChunks] = chunk;
+            p.nextRead += 1;
+        } else {
+            p.free[p.nFree] = chunk;
+            p.nFree += 1;
+        }
+        p.doneReading = atEnd;
+        pthread_cond_broadcast(&p.changed);
+        pthread_mutex_unlock(&p.lock);
+    }
+
+    for (int t = 0; t < nThreads; t += 1) {
+        pthread_join(threads[t], NULL);
+    }
+    if (ordered) {
+        pthread_join(writer, NULL);
+    }
+
+    pthread_mutex_destroy(&p.lock);
+    pthread_mutex_destroy(&p.writeLock);
+    pthread_cond_destroy(&p.changed);
+    for (int i = 0; i < p.nChunks; i += 1) {
+        free(p.chunks[i].data);
+        free(p.chunks[i].out.text);
+    }
+    free(p.chunks);
+    free(p.free);
+    free(p.bySeq);
+    free(carried);
+
+    errno = (readError != 0) ? readError : p.writeError;
+    return (errno != 0) ? -1 : 0;
+}
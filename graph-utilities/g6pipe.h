@@ -0,0 +1,58 @@
+#ifndef G6PIPE_H
+#define G6PIPE_H
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include "g6io.h"
+
+/*
+ * Parallel driver for the line-by-line graph tools (g6connected, g6compl, ...)
+ *
+ * The input is read in large chunks, each cut at its last newline (the rest of the last line is carried over to
+ *  the next chunk). Worker threads each take a whole chunk at a time and call the tool's function on every line,
+ *  which appends its output to the chunk's output buffer. The output of the chunks is then written either in
+ *  input order by a writer thread (so it is exactly what one thread would write), or, when the order doesn't
+ *  matter, by each worker as soon as it finishes a chunk.
+ */
+
+// Growable output buffer
+typedef struct G6Out {
+    char *text;
+    size_t len;
+    size_t cap;
+} G6Out;
+
+// Function called on each line (without its line ending; line->offset is the offset in the whole input)
+// 'state' is the state of the worker thread making the call (see g6RunLines)
+typedef void (*G6LineFn) (void *state, const G6Line *line, G6Out *out);
+
+
+// Make room for len more characters at the end of out
+// Returns a pointer to them (they count as written, so fill them all in)
+static inline char *g6OutReserve (G6Out *out, size_t len) {
+    if (out->len + len > out->cap) {
+        out->cap = (out->len + len > 2 * out->cap) ? out->len + len : 2 * out->cap;
+        out->text = (char*)realloc(out->text, out->cap);
+    }
+    char *space = &out->text[out->len];
+    out->len += len;
+    return space;
+}
+
+
+// Append the line (and a newline) to out
+static inline void g6OutLine (G6Out *out, const G6Line *line) {
+    char *space = g6OutReserve(out, line->len + 1);
+    memcpy(space, line->text, line->len);
+    space[line->len] = '\n';
+}
+
+
+// Run fn on every line read from inFd with nThreads worker threads, writing the output to outFd
+// states[t] is passed to every call made by worker t (so each worker can keep its own working memory)
+// If 'ordered' is 0 the output of different chunks may be written in any order
+// Returns 0 on success, or -1 (with errno set) if reading or writing failed
+int g6RunLines (int inFd, int outFd, int nThreads, int ordered, G6LineFn fn, void **states);
+
+#endif
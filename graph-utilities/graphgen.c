@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+#include "graphgen.h"
+#include "canon.h"
+
+/*
+ * Generation of connected graphs by canonical augmentation (see graphgen.h)
+ *
+ * The search is depth first, so only the current path is kept: the graph at each level lives in a stack frame
+ *  of extend, and the canonical forms of the children kept so far for the node at each level are in 'children'.
+ */
+
+typedef struct Generator {
+    int n;
+    int res;
+    int mod;
+    long splitCount; // number of nodes on GRAPHGEN_SPLIT_LEVEL(n) vertices reached so far
+    long made;
+    GraphFn fn;
+    void *arg;
+    // Canonical forms of the children kept so far of the current node on k vertices (each k + 1 VertexSets)
+    VertexSet *children[GRAPHGEN_MAX_N];
+    long nChildren[GRAPHGEN_MAX_N];
+    long childrenCap[GRAPHGEN_MAX_N];
+} Generator;
+
+
+// Returns 1 if deleting v from g leaves a connected graph, 0 otherwise
+static int isNonCutVertex (const Graph *g, int v) {
+    VertexSet rest = ALL_VERTICES(g->nVerts) & ~VERTEX_BIT(v);
+    if (rest == 0) {
+        return 1;
+    }
+    VertexSet reached = rest & -rest;
+    VertexSet frontier = reached;
+    while (frontier != 0) {
+        VertexSet next = 0;
+        for (VertexSet todo = frontier; todo != 0; todo &= todo - 1) {
+            next |= g->nbrs[__builtin_ctzll(todo)];
+        }
+        frontier = next & rest & ~reached;
+        reached |= frontier;
+    }
+    return reached == rest;
+}
+
+
+// Invariant used to choose the canonical vertex to delete: (degree, sum of the degrees of the neighbours)
+static long deletionKey (const Graph *g, int v) {
+    long sum = 0;
+    for (VertexSet rest = g->nbrs[v]; rest != 0; rest &= rest - 1) {
+        sum += __builtin_popcountll(g->nbrs[__builtin_ctzll(rest)]);
+    }
+    return ((long) __builtin_popcountll(g->nbrs[v]) << 16) | sum;
+}
+
+
+// Returns 1 if the last vertex x of h is in the same orbit of Aut(h) as the canonical vertex to delete from h
+//  (see graphgen.h), 0 otherwise
+// Sets 'canon' to the canonical form of h when returning 1
+static int isCanonicalAugmentation (const Graph *h, Graph *canon) {
+    int size = h->nVerts;
+    int x = size - 1;
+    long keyX = deletionKey(h, x);
+
+    // Deleting x leaves the parent, which is connected, so x only loses to vertices with larger keys which aren't cut vertices
+    VertexSet ties = VERTEX_BIT(x);
+    for (int v = 0; v < x; v += 1) {
+        long key = deletionKey(h, v);
+        if (key > keyX && isNonCutVertex(h, v)) {
+            return 0;
+        } else if (key == keyX && isNonCutVertex(h, v)) {
+            ties |= VERTEX_BIT(v);
+        }
+    }
+
+    int labelling[BG_MAX_VERTICES];
+    canonicalForm(h, canon, labelling);
+    if (ties == VERTEX_BIT(x)) {
+        return 1;
+    }
+
+    // The canonical vertex is the tied vertex with the largest canonical label
+    int m = x;
+    for (int i = size - 1; i >= 0; i -= 1) {
+        if ((ties >> labelling[i]) & 1) {
+            m = labelling[i];
+            break;
+        }
+    }
+    if (m == x) {
+        return 1;
+    }
+    Graph rootedX, rootedM;
+    VertexSet cellsX[2] = {VERTEX_BIT(x), ALL_VERTICES(size) & ~VERTEX_BIT(x)};
+    VertexSet cellsM[2] = {VERTEX_BIT(m), ALL_VERTICES(size) & ~VERTEX_BIT(m)};
+    canonicalFormPartitioned(h, cellsX, 2, &rootedX, NULL);
+    canonicalFormPartitioned(h, cellsM, 2, &rootedM, NULL);
+    return memcmp(rootedX.nbrs, rootedM.nbrs, sizeof(VertexSet) * size) == 0;
+}
+
+
+// Record the canonical form of a child of the current node on k vertices
+// Returns 1 if it is new, 0 if an isomorphic child was kept already
+static int addChild (Generator *gen, int k, const Graph *canon) {
+    size_t words = k + 1;
+    for (long i = 0; i < gen->nChildren[k]; i += 1) {
+        if (memcmp(&gen->children[k][i * words], canon->nbrs, sizeof(VertexSet) * words) == 0) {
+            return 0;
+        }
+    }
+    if (gen->nChildren[k] == gen->childrenCap[k]) {
+        gen->childrenCap[k] = (gen->childrenCap[k] == 0) ? 64 : 2 * gen->childrenCap[k];
+        gen->children[k] = (VertexSet*)realloc(gen->children[k], sizeof(VertexSet) * words * gen->childrenCap[k]);
+    }
+    memcpy(&gen->children[k][gen->nChildren[k] * words], canon->nbrs, sizeof(VertexSet) * words);
+    gen->nChildren[k] += 1;
+    return 1;
+}
+
+
+// Make all the graphs below the node g of the search tree
+static void extend (Generator *gen, const Graph *g) {
+    int k = g->nVerts;
+    if (k == GRAPHGEN_SPLIT_LEVEL(gen->n)) {
+        long index = gen->splitCount;
+        gen->splitCount += 1;
+        if (index % gen->mod != gen->res) {
+            return;
+        }
+    }
+    if (k == gen->n) {
+        gen->fn(gen->arg, g);
+        gen->made += 1;
+        return;
+    }
+
+    Graph h, canon;
+    h.nVerts = k + 1;
+    gen->nChildren[k] = 0;
+    for (VertexSet S = 1; S < VERTEX_BIT(k); S += 1) {
+        for (int v = 0; v < k; v += 1) {
+            h.nbrs[v] = g->nbrs[v] | (((S >> v) & 1) << k);
+        }
+        h.nbrs[k] = S;
+        if (isCanonicalAugmentation(&h, &canon) && addChild(gen, k, &canon)) {
+            extend(gen, &h);
+        }
+    }
+}
+
+
+long generateConnected (int n, int res, int mod, GraphFn fn, void *arg) {
+    Generator gen;
+    gen.n = n;
+    gen.res = res;
+    gen.mod = mod;
+    gen.splitCount = 0;
+    gen.made = 0;
+    gen.fn = fn;
+    gen.arg = arg;
+    for (int k = 0; k < GRAPHGEN_MAX_N; k += 1) {
+        gen.children[k] = NULL;
+        gen.nChildren[k] = gen.childrenCap[k] = 0;
+    }
+
+    Graph k1;
+    graphInit(&k1, 1);
+    extend(&gen, &k1);
+
+    for (int k = 0; k < GRAPHGEN_MAX_N; k += 1) {
+        free(gen.children[k]);
+    }
+    return gen.made;
+}
@@ -0,0 +1,38 @@
+#ifndef GRAPHGEN_H
+#define GRAPHGEN_H
+
+#include "bitgraph.h"
+
+/*
+ * Generation of the connected graphs on n vertices up to isomorphism, by canonical augmentation (McKay's
+ *  "canonical construction path" method, as used by nauty's geng)
+ *
+ * Every connected graph H on k + 1 >= 2 vertices has a canonical vertex to delete: of the vertices whose deletion
+ *  leaves H connected, those with the largest (degree, sum of the degrees of their neighbours), and of those the
+ *  one with the largest canonical label (see canon.h). The graphs on k + 1 vertices are made from each graph G
+ *  on k vertices by adding a vertex k joined to each non-empty subset of V(G), keeping H = G + k only if k is
+ *  in the same orbit of Aut(H) as the canonical vertex of H (so H came from the right parent) and H isn't
+ *  isomorphic to an earlier child of G (which happens when two subsets are in the same orbit of Aut(G)).
+ *  Starting from K1 this makes exactly one graph from each isomorphism class of connected graphs, in a fixed
+ *  order.
+ * The search tree can be split into 'mod' independent pieces: the nodes on GRAPHGEN_SPLIT_LEVEL(n) vertices
+ *  are numbered in the order they are made, and piece 'res' only goes below the nodes whose number is res
+ *  modulo mod (every piece makes the part of the tree above that level, which is small).
+ */
+
+// Number of vertices of the graphs at which the search tree is split between pieces
+#define GRAPHGEN_SPLIT_LEVEL(n) (((n) > 4) ? (n) - 2 : (n))
+
+// Largest number of vertices we generate graphs on (the subsets of V(G) are run through as VertexSets)
+#define GRAPHGEN_MAX_N 32
+
+// Function called on each graph made (the graph is only valid during the call)
+typedef void (*GraphFn) (void *arg, const Graph *g);
+
+// Call fn(arg, g) for one graph g from each isomorphism class of connected graphs on n vertices in piece 'res'
+//  of 'mod' (0 <= res < mod, see above)
+// Returns the number of graphs made
+// Assumes 1 <= n <= GRAPHGEN_MAX_N
+long generateConnected (int n, int res, int mod, GraphFn fn, void *arg);
+
+#endif
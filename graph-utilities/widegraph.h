@@ -0,0 +1,268 @@
+#ifndef WIDEGRAPH_H
+#define WIDEGRAPH_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Graph representation for graphs of any size (see bitgraph.h for the one used for small graphs)
+ *
+ * Each neighbourhood is a row of nWords 64-bit words: bit w % 64 of word w / 64 of the row of v is set if vw
+ *  is an edge. The rows (and some working space for searches) live in one allocation which is reused from
+ *  graph to graph, so reading a graph of the same size or smaller as the last one doesn't allocate anything.
+ */
+
+#define WIDE_WORDS(n) (((n) + 63) / 64)
+
+typedef struct WideGraph {
+    int nVerts;
+    int nWords;      // words per row (WIDE_WORDS(nVerts))
+    uint64_t *nbrs;  // the row of v starts at nbrs[v * nWords]
+    uint64_t *work;  // working space for searches (4 * nWords words)
+    size_t cap;      // number of words allocated (for the rows and working space together)
+} WideGraph;
+
+
+// Make g an empty graph that owns no memory yet
+static inline void wideGraphNew (WideGraph *g) {
+    g->nVerts = g->nWords = 0;
+    g->nbrs = g->work = NULL;
+    g->cap = 0;
+}
+
+
+static inline void wideGraphFree (WideGraph *g) {
+    free(g->nbrs);
+    wideGraphNew(g);
+}
+
+
+// Make g the graph with n vertices and no edges
+static inline void wideGraphInit (WideGraph *g, int n) {
+    size_t words = (size_t) WIDE_WORDS(n) * (n + 4);
+    if (words > g->cap) {
+        free(g->nbrs);
+        g->nbrs = (uint64_t*)malloc(sizeof(uint64_t) * words);
+        g->cap = words;
+    }
+    g->nVerts = n;
+    g->nWords = WIDE_WORDS(n);
+    g->work = &g->nbrs[(size_t) n * g->nWords];
+    memset(g->nbrs, 0, sizeof(uint64_t) * n * g->nWords);
+}
+
+
+static inline uint64_t *wideGraphRow (const WideGraph *g, int v) {
+    return &g->nbrs[(size_t) v * g->nWords];
+}
+
+
+static inline void wideGraphAddEdge (WideGraph *g, int u, int v) {
+    wideGraphRow(g, u)[v / 64] |= (uint64_t) 1 << (v % 64);
+    wideGraphRow(g, v)[u / 64] |= (uint64_t) 1 << (u % 64);
+}
+
+
+// Returns 1 if uv is an edge of g, 0 otherwise
+static inline int wideGraphHasEdge (const WideGraph *g, int u, int v) {
+    return (wideGraphRow(g, u)[v / 64] >> (v % 64)) & 1;
+}
+
+
+// Replace g with its complement
+static inline void wideGraphComplement (WideGraph *g) {
+    int n = g->nVerts;
+    for (int v = 0; v < n; v += 1) {
+        uint64_t *row = wideGraphRow(g, v);
+        for (int w = 0; w < g->nWords; w += 1) {
+            row[w] = ~row[w];
+        }
+        row[v / 64] &= ~((uint64_t) 1 << (v % 64));
+        if (n % 64 != 0) {
+            row[g->nWords - 1] &= ((uint64_t) 1 << (n % 64)) - 1;
+        }
+    }
+}
+
+
+// Returns 1 if g is connected, 0 otherwise
+static inline int wideGraphIsConnected (WideGraph *g) {
+    int n = g->nVerts;
+    int nWords = g->nWords;
+    if (n == 0) {
+        return 1;
+    }
+    uint64_t *reached = g->work;
+    uint64_t *frontier = &g->work[nWords];
+    uint64_t *next = &g->work[2 * nWords];
+    memset(reached, 0, sizeof(uint64_t) * nWords);
+    memset(frontier, 0, sizeof(uint64_t) * nWords);
+    reached[0] = frontier[0] = 1;
+
+    // Breadth first search from vertex 0, where each step adds the neighbours of the whole frontier at once
+    int count = 1;
+    int growing = 1;
+    while (growing) {
+        memset(next, 0, sizeof(uint64_t) * nWords);
+        for (int w = 0; w < nWords; w += 1) {
+            for (uint64_t rest = frontier[w]; rest != 0; rest &= rest - 1) {
+                const uint64_t *row = wideGraphRow(g, 64 * w + __builtin_ctzll(rest));
+                for (int x = 0; x < nWords; x += 1) {
+                    next[x] |= row[x];
+                }
+            }
+        }
+        growing = 0;
+        for (int w = 0; w < nWords; w += 1) {
+            frontier[w] = next[w] & ~reached[w];
+            reached[w] |= frontier[w];
+            count += __builtin_popcountll(frontier[w]);
+            growing |= (frontier[w] != 0);
+        }
+    }
+    return count == n;
+}
+
+
+// Returns 1 if the complement of g is connected, 0 otherwise (without building the complement)
+static inline int wideGraphIsCoConnected (WideGraph *g) {
+    int n = g->nVerts;
+    int nWords = g->nWords;
+    if (n == 0) {
+        return 1;
+    }
+    uint64_t *unreached = g->work;
+    uint64_t *toVisit = &g->work[nWords]; // reached but not yet searched from
+    memset(unreached, 0, sizeof(uint64_t) * nWords);
+    memset(toVisit, 0, sizeof(uint64_t) * nWords);
+    for (int v = 1; v < n; v += 1) {
+        unreached[v / 64] |= (uint64_t) 1 << (v % 64);
+    }
+    toVisit[0] = 1;
+
+    // Search from vertex 0, where the complement neighbours of v still to be reached are unreached & ~row(v)
+    int count = 1;
+    int w = 0;
+    while (w < nWords) {
+        if (toVisit[w] == 0) {
+            w += 1;
+            continue;
+        }
+        int v = 64 * w + __builtin_ctzll(toVisit[w]);
+        toVisit[w] &= toVisit[w] - 1;
+        const uint64_t *row = wideGraphRow(g, v);
+        for (int x = 0; x < nWords; x += 1) {
+            uint64_t found = unreached[x] & ~row[x];
+            unreached[x] &= ~found;
+            toVisit[x] |= found;
+            count += __builtin_popcountll(found);
+        }
+        w = 0;
+    }
+    return count == n;
+}
+
+
+// Number of neighbours of v
+static inline int wideGraphDegree (const WideGraph *g, int v) {
+    const uint64_t *row = wideGraphRow(g, v);
+    int degree = 0;
+    for (int w = 0; w < g->nWords; w += 1) {
+        degree += __builtin_popcountll(row[w]);
+    }
+    return degree;
+}
+
+
+static inline long wideGraphNumEdges (const WideGraph *g) {
+    long twiceEdges = 0;
+    for (int v = 0; v < g->nVerts; v += 1) {
+        twiceEdges += wideGraphDegree(g, v);
+    }
+    return twiceEdges / 2;
+}
+
+
+// Returns 1 if g has no triangle, 0 otherwise
+static inline int wideGraphIsTriangleFree (const WideGraph *g) {
+    // uvw is a triangle with u < v < w iff w is in the common neighbourhood of the edge uv
+    for (int u = 0; u < g->nVerts; u += 1) {
+        const uint64_t *rowU = wideGraphRow(g, u);
+        for (int x = (u + 1) / 64; x < g->nWords; x += 1) {
+            uint64_t later = rowU[x];
+            if (x == u / 64) {
+                later &= ~(((uint64_t) 2 << (u % 64)) - 1);
+            }
+            for (; later != 0; later &= later - 1) {
+                const uint64_t *rowV = wideGraphRow(g, 64 * x + __builtin_ctzll(later));
+                for (int w = 0; w < g->nWords; w += 1) {
+                    if ((rowU[w] & rowV[w]) != 0) {
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+
+// Returns 1 if g is bipartite, 0 otherwise
+static inline int wideGraphIsBipartite (WideGraph *g) {
+    int n = g->nVerts;
+    int nWords = g->nWords;
+    uint64_t *reached = g->work;
+    uint64_t *frontier = &g->work[nWords];
+    uint64_t *next = &g->work[2 * nWords];
+    uint64_t *odd = &g->work[3 * nWords]; // vertices at odd distance from the start of their component
+    memset(reached, 0, sizeof(uint64_t) * nWords);
+    memset(odd, 0, sizeof(uint64_t) * nWords);
+
+    // Breadth first search of each component in turn (as in wideGraphIsConnected), 2-colouring it by layer
+    for (int start = 0; start < n; start += 1) {
+        if ((reached[start / 64] >> (start % 64)) & 1) {
+            continue;
+        }
+        memset(frontier, 0, sizeof(uint64_t) * nWords);
+        frontier[start / 64] = (uint64_t) 1 << (start % 64);
+        reached[start / 64] |= frontier[start / 64];
+        int parity = 0;
+        int growing = 1;
+        while (growing) {
+            memset(next, 0, sizeof(uint64_t) * nWords);
+            for (int w = 0; w < nWords; w += 1) {
+                for (uint64_t rest = frontier[w]; rest != 0; rest &= rest - 1) {
+                    const uint64_t *row = wideGraphRow(g, 64 * w + __builtin_ctzll(rest));
+                    for (int x = 0; x < nWords; x += 1) {
+                        next[x] |= row[x];
+                    }
+                }
+            }
+            parity ^= 1;
+            growing = 0;
+            for (int w = 0; w < nWords; w += 1) {
+                frontier[w] = next[w] & ~reached[w];
+                reached[w] |= frontier[w];
+                if (parity) {
+                    odd[w] |= frontier[w];
+                }
+                growing |= (frontier[w] != 0);
+            }
+        }
+    }
+
+    // The layers give a proper 2-colouring iff g is bipartite
+    for (int v = 0; v < n; v += 1) {
+        const uint64_t *row = wideGraphRow(g, v);
+        uint64_t sameColour = ((odd[v / 64] >> (v % 64)) & 1) ? ~(uint64_t) 0 : 0;
+        for (int w = 0; w < nWords; w += 1) {
+            if ((row[w] & ~(odd[w] ^ sameColour)) != 0) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+#endif
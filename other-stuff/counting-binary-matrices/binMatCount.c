@@ -1,6 +1,9 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "stdbool.h"
+#include "stdint.h"
+#include "unistd.h"
+#include "pthread.h"
 #include "gmp-6.1.0/gmp.h" // Because numbers get big
 
 
@@ -17,43 +20,135 @@
     (void) (&_min1 == &_min2);      \
     _min1 < _min2 ? _min1 : _min2; })
 
+// Same for max
+#define max(x, y) ({                \
+    typeof(x) _max1 = (x);          \
+    typeof(y) _max2 = (y);          \
+    (void) (&_max1 == &_max2);      \
+    _max1 > _max2 ? _max1 : _max2; })
+
 
 /* Matrix type
  *
- * Store columns as unsigned integers
+ * Store columns as bit vectors of 'words' 64-bit words each (least significant word first), packed one after
+ *  the other in colArr, so a matrix may have up to MAX_ROWS rows
  * Always order columns from smallest to largest integer (to avoid permutations of columns,
  *  we will count the number of possible permutations after)
  * use bitwise xor to subtract columns from one another
  * use bitwise and with an integer having only one bit to check for 1s
  */
+typedef uint64_t Word;
+
+#define WORD_BITS 64
+// Most words in a column (there is a copy of the counting kernel for each number of words up to this)
+#define MAX_WORDS 4
+#define MAX_ROWS (MAX_WORDS * WORD_BITS)
+
 typedef struct Matrix {
     int height;
     int width;
     int supp;
-    unsigned int *colArr;
+    int words;  // words per column, (height + WORD_BITS - 1) / WORD_BITS
+    Word *colArr;
 } Matrix;
 
+// Column c of Mat
+#define COLUMN(Mat, c) (&(Mat)->colArr[(c) * (Mat)->words])
+
 
 // Notes:
 //   All functions assume the matrices are not null (unless otherwise specified)
-//   No matrix or column vector may have more than sizeof(unsigned int) rows
+//   No matrix or column vector may have more than MAX_ROWS rows
+//   Functions taking the number of words as an argument are always inlined, so that in the counting kernels
+//    (one for each number of words, see CountRanks) it is a compile-time constant, and the loops over the words
+//    of a column are unrolled (a one-word column costs about what a single integer does)
+
+
+// Always inline a function (so that constant arguments are propagated into its body)
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+
+// Returns true if the columns u and v are equal
+ALWAYS_INLINE bool ColumnEqual (const Word *u, const Word *v, int words) {
+    bool equal = true;
+    for (int i = 0; i < words; i += 1) {
+        equal &= (u[i] == v[i]);
+    }
+    return equal;
+}
+
+
+// Returns true if the column u is smaller than v (as integers)
+ALWAYS_INLINE bool ColumnLess (const Word *u, const Word *v, int words) {
+    for (int i = words - 1; i > 0; i -= 1) {
+        if (u[i] != v[i]) {
+            return u[i] < v[i];
+        }
+    }
+    return u[0] < v[0];
+}
 
 
-// Returns a vector of length m with s ones in the "bottom" (least significant coordinates)
+ALWAYS_INLINE bool ColumnIsZero (const Word *v, int words) {
+    Word any = 0;
+    for (int i = 0; i < words; i += 1) {
+        any |= v[i];
+    }
+    return any == 0;
+}
+
+
+ALWAYS_INLINE void ColumnCopy (Word *u, const Word *v, int words) {
+    for (int i = 0; i < words; i += 1) {
+        u[i] = v[i];
+    }
+}
+
+
+// u = u xor v
+ALWAYS_INLINE void ColumnXor (Word *u, const Word *v, int words) {
+    for (int i = 0; i < words; i += 1) {
+        u[i] ^= v[i];
+    }
+}
+
+
+// Set v to the vector whose s lowest bits are ones (and the rest zeros)
+ALWAYS_INLINE void ColumnSetLowBits (Word *v, int words, int s) {
+    for (int i = 0; i < words; i += 1) {
+        int lo = i * WORD_BITS;
+        v[i] = (s >= lo + WORD_BITS) ? ~(Word)0 : (s <= lo) ? 0 : ((Word)1 << (s - lo)) - 1;
+    }
+}
+
+
+// Returns the row of the highest 1 in v, or -1 if v is zero
+ALWAYS_INLINE int ColumnHighestBit (const Word *v, int words) {
+    for (int i = words - 1; i >= 0; i -= 1) {
+        if (v[i] != 0) {
+            return i * WORD_BITS + WORD_BITS - 1 - __builtin_clzll(v[i]);
+        }
+    }
+    return -1;
+}
+
+
+// Returns true if row b of the column v is a 1
+bool ColumnBit (const Word *v, int b) {
+    return (v[b / WORD_BITS] >> (b % WORD_BITS)) & 1;
+}
+
+
+// Set v to a vector of length m with s ones in the "bottom" (least significant coordinates)
 // (our implementation doesn't need m, but it might catch bugs and makes it easier to
 //  change the implementation later)
-unsigned int leastVector (int m, int s) {
+void leastVector (Word *v, int words, int m, int s) {
     if (s > m) {
         fprintf(stderr, "leastColumn: Warning! [s too large]\n");
         fprintf(stderr, "  s (value: %d) is greater than m (value: %d). Setting s = m.\n", s, m);
         s = m;
     }
-
-    unsigned int v = 0;
-    for (int i = 0; i < s; i += 1) {
-        v |= (1 << i);
-    }
-    return v;
+    ColumnSetLowBits(v, words, s);
 }
 
 
@@ -70,14 +165,12 @@ Matrix *MatrixCreate (int m, int n, int s) {
     Mat->height = m;
     Mat->width = n;
     Mat->supp = s;
+    Mat->words = (m + WORD_BITS - 1) / WORD_BITS;
 
-    unsigned int *M = (unsigned int*)malloc(sizeof(unsigned int) * n);
-    unsigned int v = leastVector(m, s);
-
+    Mat->colArr = (Word*)malloc(sizeof(Word) * Mat->words * n);
     for (int c = 0; c < n; c += 1) {
-        M[c] = v;
+        leastVector(COLUMN(Mat, c), Mat->words, m, s);
     }
-    Mat->colArr = M;
     return Mat;
 }
 
@@ -91,11 +184,9 @@ void MatrixFree (Matrix *Mat) {
 // Prints an m-by-n binary matrix
 // Each line has a leading space because it was simpler (and kinda looks nice?).
 void MatrixPrint (Matrix *Mat) {
-    unsigned int *M = Mat->colArr;
-
-    for (unsigned int row = 1 << (Mat->height-1); row > 0; row >>= 1) {
+    for (int row = Mat->height - 1; row >= 0; row -= 1) {
         for (int col = 0; col < Mat->width; col += 1) {
-            if (M[col] & row) {
+            if (ColumnBit(COLUMN(Mat, col), row)) {
                 printf(" 1");
             } else {
                 printf(" 0");
@@ -106,106 +197,74 @@ void MatrixPrint (Matrix *Mat) {
 }
 
 
-// Copies the entries of the binary matrix M into the binary matrix N
-// Assumes both matrices are m-by-n
-void MatrixCopy (Matrix *Mat1, Matrix *Mat2) {
-    if (Mat1->height != Mat2->height || Mat1->width != Mat2->width) {
-        fprintf(stderr, "MatrixCopy: ERROR! [Order of arguments differ]");
-        fprintf(stderr, "Arguments are %dx%d and %dx%d respectively.", Mat1->height, Mat1->width, Mat2->height, Mat2->width);
-        fprintf(stderr, "Aborting MatrixCopy");
-        return;
+// "Increment" the given vector v (which has m entries): move on to the next vector with as many ones
+// The lowest run of ones moves up, i.e. the 0 just above it becomes a 1 and the rest of the run goes to the bottom
+ALWAYS_INLINE bool VectorIncrement (Word *v, int words, int m) {
+    // Find the lowest 1, and then the lowest 0 above it
+    int i = 0;
+    while (i < words && v[i] == 0) {
+        i += 1;
     }
-    unsigned int *M = Mat1->colArr, *N = Mat2->colArr;
-
-    for (int c = 0; c < Mat1->width; c += 1) {
-        N[c] = M[c];
-    }
-}
-
-
-// "Increment" the given vector v (which has m entries)
-bool VectorIncrement (unsigned int *v, int m) {
-    // Look for 01 among bits
-    int numBits = 0;
-    unsigned int i = 1; //   01
-    unsigned int ii = 2; //  10 = ~01
-    unsigned int iii = 3; // 11
-    while (ii <= (1 << (m - 1))) {
-        if (((*v ^ ii) & iii) == iii) {
-            // Bump up bit i, reset lower bits
-            *v |= ii;
-            do {
-                *v &= ~i;
-                i >>= 1;
-            } while (i > 0);
-            *v |= leastVector(m,numBits);
-            return true;
-        } else if (*v & i) {
-            numBits += 1;
-        }
-        i <<= 1;
-        ii <<= 1;
-        iii <<= 1;
+    if (i == words) {
+        return false;
+    }
+    int low = i * WORD_BITS + __builtin_ctzll(v[i]);
+    Word zeros = ~v[i] & (~(Word)0 << (low % WORD_BITS));
+    while (zeros == 0 && i + 1 < words) {
+        i += 1;
+        zeros = ~v[i];
+    }
+    int high = (zeros == 0) ? words * WORD_BITS : i * WORD_BITS + __builtin_ctzll(zeros);
+    if (high >= m) {
+        return false;
+    }
+
+    // Bump up bit 'high', and put the other high - low - 1 ones of the run at the bottom
+    int ones = high - low - 1;
+    for (int j = 0; j < words; j += 1) {
+        int lo = j * WORD_BITS;
+        Word keep = (high <= lo) ? ~(Word)0 : (high >= lo + WORD_BITS) ? 0 : ~(Word)0 << (high - lo);
+        Word bottom = (ones >= lo + WORD_BITS) ? ~(Word)0 : (ones <= lo) ? 0 : ((Word)1 << (ones - lo)) - 1;
+        v[j] = (v[j] & keep) | bottom;
     }
-    return false;
+    v[high / WORD_BITS] |= (Word)1 << (high % WORD_BITS);
+    return true;
 }
 
 
-// "Increment" given matrix
-bool MatrixIncrement (Matrix *Mat) {
-    unsigned int *M = Mat->colArr;
+// "Increment" given matrix, leaving the columns before column 'first' alone
+// (so this runs through the matrices which start with the same first columns)
+// Returns the first column which changed (all columns after it are reset), or -1 if there is no next matrix
+// words must be Mat->words
+ALWAYS_INLINE int MatrixIncrementFrom (Matrix *Mat, int first, int words) {
+    Word *M = Mat->colArr;
 
-    // Find a column to increment (default to first column)
+    // Find a column to increment (default to column 'first')
     int c = 0;
-    for (c = Mat->width - 1; c > 0; c -= 1) {
-        if (M[c] < M[c-1]) {
+    for (c = Mat->width - 1; c > first; c -= 1) {
+        if (ColumnLess(&M[c * words], &M[(c-1) * words], words)) {
             break;
         }
     }
+    // Columns are in decreasing order, so column 'first' can't grow if it equals the column before it
+    if (c < first || (c > 0 && ColumnEqual(&M[c * words], &M[(c-1) * words], words))) {
+        return -1;
+    }
 
     // Attempt to increment column
-    bool success = VectorIncrement(&M[c], Mat->height);
-    if (success) {
-        unsigned int v = leastVector(Mat->height, Mat->supp);
-        for (c += 1; c < Mat->width; c += 1) {
-            M[c] = v;
-        }
+    if (!VectorIncrement(&M[c * words], words, Mat->height)) {
+        return -1;
     }
-    return success;
+    for (int i = c + 1; i < Mat->width; i += 1) {
+        ColumnSetLowBits(&M[i * words], words, Mat->supp);
+    }
+    return c;
 }
 
 
-// Computes rank of m-by-n binary matrix M
-// Modifies Mat
-int MatrixRank (Matrix *Mat) {
-    unsigned int *M = Mat->colArr;
-    unsigned int row = 1 << (Mat->height-1);
-    int col = 0;
-
-    // Row-reduce matrix
-    while (row > 0 && col < Mat->width) {
-        if (M[col] == 0) {
-            col += 1;
-        }else if ((M[col] & row) > 0) {
-            for (int i = 0; i < Mat->width; i += 1) {
-                if ((M[i] & row) > 0 && i != col) {
-                    M[i] ^= M[col];
-                }
-            }
-            row >>= 1;
-            col += 1;
-        } else {
-            row >>= 1;
-        }
-    }
-
-    int rank = 0;
-    for (int c = 0; c < Mat->width; c += 1) {
-        if (M[c] > 0) {
-            rank += 1;
-        }
-    }
-    return rank;
+// "Increment" given matrix
+bool MatrixIncrement (Matrix *Mat) {
+    return MatrixIncrementFrom(Mat, 0, Mat->words) >= 0;
 }
 
 
@@ -220,12 +279,11 @@ void MatrixConjClassSize (Matrix *Mat, mpz_t *result) {
         colUnused[i] = true;
     }
 
-    unsigned int *M = Mat->colArr;
     for (int c = 0; c < Mat->width; c += 1) {
         if (colUnused[c]) {
             colClass[c] = 1;
             for (int i = c+1; i < Mat->width; i += 1) {
-                if (colUnused[i] && M[c] == M[i]) {
+                if (colUnused[i] && ColumnEqual(COLUMN(Mat, c), COLUMN(Mat, i), Mat->words)) {
                     colUnused[i] = false;
                     colClass[c] += 1;
                 }
@@ -249,16 +307,567 @@ void MatrixConjClassSize (Matrix *Mat, mpz_t *result) {
 
 
 
+/* Counting permutations of columns
+ *
+ * The columns of the matrices we enumerate are in decreasing order, so equal columns are next to each other, and
+ *  the number of matrices we get by permuting the columns is a multinomial coefficient. Let runLen[c] be the
+ *  number of columns up to column c equal to column c (so the run of equal columns containing column c ends with
+ *  runLen[c] = its multiplicity). The number of ways to arrange the first c + 1 columns is then
+ *
+ *      arrangements[c + 1] = arrangements[c + 1 - runLen[c]] * C(c + 1, runLen[c])
+ *
+ *  (choose where the copies of column c go), which only changes from the column MatrixIncrementFrom changed on.
+ *  The binomial coefficients come from a table, and everything fits in 128 bits as long as n <= MAX_FAST_WIDTH
+ *  (n! < 2^128). For wider matrices we fall back on MatrixConjClassSize and GMP.
+ * The counts for each rank are also added up in 128 bits, and only moved into the GMP totals at the end (or when
+ *  they would overflow).
+ */
+
+typedef unsigned __int128 uint128;
+
+// Most columns for which n! < 2^128
+#define MAX_FAST_WIDTH 34
+
+// binomials[i][j] = C(i,j) for i, j <= MAX_FAST_WIDTH (filled in by InitBinomials)
+uint128 binomials[MAX_FAST_WIDTH + 1][MAX_FAST_WIDTH + 1];
+
+
+void InitBinomials (void) {
+    for (int i = 0; i <= MAX_FAST_WIDTH; i += 1) {
+        binomials[i][0] = 1;
+        for (int j = 1; j <= MAX_FAST_WIDTH; j += 1) {
+            binomials[i][j] = (i == 0) ? 0 : binomials[i-1][j-1] + binomials[i-1][j];
+        }
+    }
+}
+
+
+// Add the unsigned 128-bit integer x to z
+void mpzAddUint128 (mpz_t z, uint128 x) {
+    unsigned long long words[2] = {(unsigned long long) x, (unsigned long long) (x >> 64)};
+    mpz_t y;
+    mpz_init(y);
+    mpz_import(y, 2, -1, sizeof(words[0]), 0, 0, words);
+    mpz_add(z, z, y);
+    mpz_clear(y);
+}
+
+
+// Bring runLen and arrangements (see above) up to date for the columns of Mat from column 'from' on
+// Assumes Mat has at most MAX_FAST_WIDTH columns, and words is Mat->words
+ALWAYS_INLINE void UpdateArrangements (Matrix *Mat, int from, int *runLen, uint128 *arrangements, int words) {
+    Word *M = Mat->colArr;
+    arrangements[0] = 1;
+    for (int c = from; c < Mat->width; c += 1) {
+        runLen[c] = (c > 0 && ColumnEqual(&M[c * words], &M[(c-1) * words], words)) ? runLen[c-1] + 1 : 1;
+        arrangements[c+1] = arrangements[c+1 - runLen[c]] * binomials[c+1][runLen[c]];
+    }
+}
+
+
+/* Incremental rank
+ *
+ * Consecutive matrices share all their columns before the one MatrixIncrementFrom changed, so we keep a row
+ *  echelon form of the columns so far instead of row-reducing every matrix from scratch: pivots[b] (a column,
+ *  stored like those of the matrix) is 0 or a combination of columns whose highest 1 is in row b. Each column either reduces to 0 against the pivots added
+ *  by the columns before it, or adds one new pivot, whose row we record in addedPivot[c] (-1 if there isn't one),
+ *  and prefixRank[c] is the rank of the first c columns. To change the columns from column c on, we take out the
+ *  pivots they added and reduce the new ones. A column equal to the one before it never adds a pivot, so the
+ *  columns MatrixIncrementFrom resets (which are all equal) cost next to nothing.
+ */
+
+
+// Bring pivots, addedPivot and prefixRank (see above) up to date for the columns of Mat from column 'from' on
+// words must be Mat->words
+ALWAYS_INLINE void UpdateRank (Matrix *Mat, int from, Word *pivots, int *addedPivot, int *prefixRank, int words) {
+    Word *M = Mat->colArr;
+    for (int c = from; c < Mat->width; c += 1) {
+        if (addedPivot[c] >= 0) {
+            ColumnSetLowBits(&pivots[addedPivot[c] * words], words, 0);
+        }
+    }
+
+    prefixRank[0] = 0;
+    for (int c = from; c < Mat->width; c += 1) {
+        addedPivot[c] = -1;
+        if (c == 0 || !ColumnEqual(&M[c * words], &M[(c-1) * words], words)) {
+            // Clear the highest 1 of v with a pivot until there's no pivot for it (or nothing is left of v)
+            Word v[MAX_WORDS];
+            ColumnCopy(v, &M[c * words], words);
+            int b;
+            while ((b = ColumnHighestBit(v, words)) >= 0) {
+                Word *pivot = &pivots[b * words];
+                if (ColumnIsZero(pivot, words)) {
+                    ColumnCopy(pivot, v, words);
+                    addedPivot[c] = b;
+                    break;
+                }
+                ColumnXor(v, pivot, words);
+            }
+        }
+        prefixRank[c+1] = prefixRank[c] + (addedPivot[c] >= 0);
+    }
+}
+
+
+// Add the number of matrices of each rank among those starting with the first 'first' columns of Mat (from Mat
+//  onwards) to ranks (see MatrixIncrementFrom)
+// words must be Mat->words
+ALWAYS_INLINE void CountRanksKernel (Matrix *Mat, int first, mpz_t *ranks, int words) {
+    int n = Mat->width;
+    int rs = min(Mat->height, n) + 1;
+
+    Word pivots[Mat->height * words];
+    int addedPivot[n];
+    int prefixRank[n + 1];
+    for (int b = 0; b < Mat->height; b += 1) {
+        ColumnSetLowBits(&pivots[b * words], words, 0);
+    }
+    for (int c = 0; c < n; c += 1) {
+        addedPivot[c] = -1;
+    }
+
+    int changed = 0;
+    if (n > MAX_FAST_WIDTH) {
+        mpz_t z; // Only used for intermediate computations
+        mpz_init(z);
+        do {
+            UpdateRank(Mat, changed, pivots, addedPivot, prefixRank, words);
+            int r = prefixRank[n];
+            MatrixConjClassSize(Mat, &z);
+            mpz_add(ranks[r], ranks[r], z);
+            changed = MatrixIncrementFrom(Mat, first, words);
+        } while (changed >= 0);
+        mpz_clear(z);
+        return;
+    }
+
+    int runLen[n];
+    uint128 arrangements[n + 1];
+    uint128 counts[rs];
+    for (int r = 0; r < rs; r += 1) {
+        counts[r] = 0;
+    }
+
+    do {
+        UpdateArrangements(Mat, changed, runLen, arrangements, words);
+        UpdateRank(Mat, changed, pivots, addedPivot, prefixRank, words);
+        int r = prefixRank[n];
+        uint128 z = arrangements[n];
+        if (counts[r] + z < z) {
+            mpzAddUint128(ranks[r], counts[r]);
+            counts[r] = 0;
+        }
+        counts[r] += z;
+        changed = MatrixIncrementFrom(Mat, first, words);
+    } while (changed >= 0);
+
+    for (int r = 0; r < rs; r += 1) {
+        mpzAddUint128(ranks[r], counts[r]);
+    }
+}
+
+
+// Specialise the counting kernel for each number of words per column, so that it is a compile-time constant in
+//  each copy
+typedef void (*CountRanksFn) (Matrix *Mat, int first, mpz_t *ranks);
+
+#define DEFINE_COUNT_RANKS(words)                                       \
+    void CountRanks##words (Matrix *Mat, int first, mpz_t *ranks) {    \
+        CountRanksKernel(Mat, first, ranks, words);                     \
+    }
+
+DEFINE_COUNT_RANKS(1)
+DEFINE_COUNT_RANKS(2)
+DEFINE_COUNT_RANKS(3)
+DEFINE_COUNT_RANKS(4)
+
+const CountRanksFn countRanksKernels[MAX_WORDS + 1] = {NULL, CountRanks1, CountRanks2, CountRanks3, CountRanks4};
+
+
+// Add the number of matrices of each rank among those starting with the first 'first' columns of Mat (from Mat
+//  onwards) to ranks (see MatrixIncrementFrom)
+void CountRanks (Matrix *Mat, int first, mpz_t *ranks) {
+    countRanksKernels[Mat->words](Mat, first, ranks);
+}
+
+
+/* Parallel counting
+ *
+ * The matrices are split up by their first prefixLen columns (their "prefix"). Since the columns are in decreasing
+ *  order, the matrices with a given prefix are the ones whose remaining columns are in decreasing order and no
+ *  bigger than the last column of the prefix, which is what MatrixIncrementFrom runs through. Prefixes are handed
+ *  out one at a time from a shared queue, so the threads stay busy even though the prefixes with big columns
+ *  have a lot more matrices than the others. Each thread adds up its ranks in its own array, and these are added
+ *  together at the end.
+ */
+
+// Default number of prefixes per thread (we take the shortest prefixes which give at least this many)
+#define PREFIXES_PER_THREAD 64
+
+typedef struct WorkQueue {
+    pthread_mutex_t lock;
+    Matrix *prefix;   // the next prefix to hand out (a matrix with prefixLen columns)
+    bool done;        // true once every prefix has been handed out
+} WorkQueue;
+
+typedef struct Worker {
+    pthread_t thread;
+    WorkQueue *queue;
+    int m, n, s;
+    int prefixLen;
+    mpz_t *ranks;
+} Worker;
+
+
+// Copy the next prefix of the queue into the first columns of Mat, and set the other columns to their least value
+// Returns false if there are no prefixes left
+bool TakePrefix (WorkQueue *queue, Matrix *Mat) {
+    pthread_mutex_lock(&queue->lock);
+    bool taken = !queue->done;
+    if (taken) {
+        Matrix *prefix = queue->prefix;
+        for (int c = 0; c < Mat->width; c += 1) {
+            if (c < prefix->width) {
+                ColumnCopy(COLUMN(Mat, c), COLUMN(prefix, c), Mat->words);
+            } else {
+                leastVector(COLUMN(Mat, c), Mat->words, Mat->height, Mat->supp);
+            }
+        }
+        queue->done = !MatrixIncrement(prefix);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return taken;
+}
+
+
+void *WorkerThread (void *arg) {
+    Worker *w = (Worker*)arg;
+    Matrix *M = MatrixCreate(w->m, w->n, w->s);
+    while (TakePrefix(w->queue, M)) {
+        CountRanks(M, w->prefixLen, w->ranks);
+    }
+    MatrixFree(M);
+    return NULL;
+}
+
+
+// Returns the shortest prefix length (at most n) for which there are at least 'wanted' prefixes
+int DefaultPrefixLen (int m, int n, int s, long wanted) {
+    // There are C(m,s) possible columns, and a prefix of length p is a multiset of p of them
+    double cols = 1;
+    for (int i = 0; i < s; i += 1) {
+        cols = cols * (m - i) / (i + 1);
+    }
+    double prefixes = 1;
+    int p = 0;
+    while (p < n && prefixes < wanted) {
+        p += 1;
+        prefixes = prefixes * (cols + p - 1) / p;
+    }
+    return (p > 0) ? p : 1;
+}
+
+
+// Count the matrices of each rank with nThreads threads, splitting them up by their first prefixLen columns
+void CountRanksParallel (int m, int n, int s, int nThreads, int prefixLen, mpz_t *ranks, int rs) {
+    WorkQueue queue;
+    pthread_mutex_init(&queue.lock, NULL);
+    queue.prefix = MatrixCreate(m, prefixLen, s);
+    queue.done = false;
+
+    Worker workers[nThreads];
+    for (int t = 0; t < nThreads; t += 1) {
+        workers[t].queue = &queue;
+        workers[t].m = m;
+        workers[t].n = n;
+        workers[t].s = s;
+        workers[t].prefixLen = prefixLen;
+        workers[t].ranks = (mpz_t*)malloc(sizeof(mpz_t) * rs);
+        for (int r = 0; r < rs; r += 1) {
+            mpz_init(workers[t].ranks[r]);
+        }
+        pthread_create(&workers[t].thread, NULL, WorkerThread, &workers[t]);
+    }
+
+    for (int t = 0; t < nThreads; t += 1) {
+        pthread_join(workers[t].thread, NULL);
+        for (int r = 0; r < rs; r += 1) {
+            mpz_add(ranks[r], ranks[r], workers[t].ranks[r]);
+            mpz_clear(workers[t].ranks[r]);
+        }
+        free(workers[t].ranks);
+    }
+    MatrixFree(queue.prefix);
+    pthread_mutex_destroy(&queue.lock);
+}
+
+
+/* Counting by the span of the columns
+ *
+ * Instead of going through the matrices, go through the ways the span of the columns can grow. Reading the
+ *  columns from left to right, each column is either in the span W of the columns before it (there are inSpan
+ *  such columns with support s, which only depends on W), or makes the span bigger. So a matrix of rank r is a
+ *  chain of r independent columns with columns from the span so far mixed in, and only the chains need to be
+ *  gone through: if arrivals[t] counts the sequences of t columns ending with the last column of the chain, then
+ *
+ *      current[t] = arrivals[t] + inSpan * current[t-1]
+ *
+ *  counts the sequences of t columns with the same span (and ranks[k] gets current[n]). Adding a column v from
+ *  outside the span to sequences of t columns gives arrivals[t+1] = current[t] for the longer chain.
+ * Everything we need about W is invariant under permuting rows, so we don't keep the columns v_0,...,v_{k-1} of
+ *  the chain, only their rows up to order: row i has the k-bit pattern whose bit j is row i of v_j, and a
+ *  RowClass says how many rows have a given pattern. A column with support s is then a choice of how many rows
+ *  choice[j] of each class j have a 1 in it (with C(count, choice[j]) ways to pick these rows), and adding it
+ *  to the chain splits each class in two. The column is in the span exactly when the rows of the chain extended
+ *  by it still have rank k (every class is then all 0s or all 1s in it).
+ * The chains are gone through depth first. Their number (up to the order of the rows) doesn't depend on n beyond
+ *  the rank, and is small for tall matrices with small s, which are exactly the cases enumeration can't reach.
+ */
+
+// Highest rank the patterns of a RowClass have room for
+#define MAX_SPAN_RANK 63
+
+typedef struct RowClass {
+    uint64_t pattern;
+    int count;
+} RowClass;
+
+// State shared by the whole search
+typedef struct SpanSearch {
+    int m, n, s;
+    mpz_t *binoms;   // binoms[i * (s + 1) + j] = C(i,j) for i <= m and j <= s
+    mpz_t columns;   // C(m,s), the number of possible columns
+    mpz_t *ranks;
+} SpanSearch;
+
+// A chain with its rows split into classes, and working space for choosing the next column (see SpanChoose)
+typedef struct SpanNode {
+    RowClass *rows;
+    int nClasses;
+    int k;                 // length (and rank) of the chain
+    int *choice;
+    int *rest;             // rest[j] = number of rows in the classes j, j+1, ...
+    mpz_t *ways;           // ways[j] = number of columns with the choices for classes before j
+    mpz_t *current;        // see above
+    unsigned long inSpan;  // at most 2^k
+    bool extend;           // false while counting the columns in the span, true while extending the chain
+    RowClass *childRows;
+    mpz_t *childArrivals;
+} SpanNode;
+
+
+void SpanVisit (SpanSearch *S, RowClass *rows, int nClasses, int k, mpz_t *arrivals);
+
+
+// Returns true if the column given by node->choice is in the span of the chain
+bool ChoiceInSpan (SpanNode *node) {
+    uint64_t pivots[MAX_SPAN_RANK + 1] = {0};
+    uint64_t bit = (uint64_t)1 << node->k;
+    int rank = 0;
+    for (int j = 0; j < node->nClasses; j += 1) {
+        int a = node->choice[j];
+        if (a != 0 && a != node->rows[j].count) {
+            return false;
+        }
+        // Same elimination as UpdateRank
+        uint64_t v = node->rows[j].pattern | ((a > 0) ? bit : 0);
+        while (v != 0) {
+            int b = 63 - __builtin_clzll(v);
+            if (pivots[b] == 0) {
+                pivots[b] = v;
+                rank += 1;
+                break;
+            }
+            v ^= pivots[b];
+        }
+    }
+    return rank == node->k;
+}
+
+
+// Go through the ways of choosing choice[j],...,choice[nClasses-1] adding up to 'remaining', and either count
+//  the columns in the span, or extend the chain with each of the others (according to node->extend)
+void SpanChoose (SpanSearch *S, SpanNode *node, int j, int remaining) {
+    if (j == node->nClasses) {
+        bool inSpan = ChoiceInSpan(node);
+        if (!node->extend) {
+            node->inSpan += inSpan;
+        } else if (!inSpan) {
+            uint64_t bit = (uint64_t)1 << node->k;
+            int nChild = 0;
+            for (int i = 0; i < node->nClasses; i += 1) {
+                RowClass *class = &node->rows[i];
+                if (class->count > node->choice[i]) {
+                    node->childRows[nChild++] = (RowClass) {class->pattern, class->count - node->choice[i]};
+                }
+                if (node->choice[i] > 0) {
+                    node->childRows[nChild++] = (RowClass) {class->pattern | bit, node->choice[i]};
+                }
+            }
+            for (int t = node->k; t < S->n; t += 1) {
+                mpz_mul(node->childArrivals[t+1], node->ways[j], node->current[t]);
+            }
+            SpanVisit(S, node->childRows, nChild, node->k + 1, node->childArrivals);
+        }
+        return;
+    }
+
+    int count = node->rows[j].count;
+    for (int a = max(0, remaining - node->rest[j+1]); a <= min(count, remaining); a += 1) {
+        // Columns in the span have all 0s or all 1s in each class
+        if (!node->extend && a != 0 && a != count) {
+            continue;
+        }
+        node->choice[j] = a;
+        if (node->extend) {
+            mpz_mul(node->ways[j+1], node->ways[j], S->binoms[count * (S->s + 1) + a]);
+        }
+        SpanChoose(S, node, j + 1, remaining - a);
+    }
+}
+
+
+// Add the sequences of columns whose chain of independent columns starts with the chain whose rows are given,
+//  to ranks, where arrivals[t] (for t = 0,...,n) counts the sequences of t columns ending with this chain
+void SpanVisit (SpanSearch *S, RowClass *rows, int nClasses, int k, mpz_t *arrivals) {
+    int n = S->n;
+    int choice[nClasses];
+    int rest[nClasses + 1];
+    mpz_t current[n + 1];
+    SpanNode node = {rows, nClasses, k, choice, rest, NULL, current, 0, false, NULL, NULL};
+
+    rest[nClasses] = 0;
+    for (int j = nClasses - 1; j >= 0; j -= 1) {
+        rest[j] = rest[j+1] + rows[j].count;
+    }
+    SpanChoose(S, &node, 0, S->s);
+
+    for (int t = 0; t <= n; t += 1) {
+        mpz_init(current[t]);
+        if (t >= k) {
+            mpz_set(current[t], arrivals[t]);
+            if (t > k) {
+                mpz_addmul_ui(current[t], current[t-1], node.inSpan);
+            }
+        }
+    }
+    mpz_add(S->ranks[k], S->ranks[k], current[n]);
+
+    if (k + 1 == n) {
+        // Longer chains use up all the columns, so we only need to know how many columns make the span bigger
+        mpz_t outside;
+        mpz_init(outside);
+        mpz_sub_ui(outside, S->columns, node.inSpan);
+        mpz_addmul(S->ranks[n], current[n-1], outside);
+        mpz_clear(outside);
+    } else if (k + 1 < n) {
+        mpz_t ways[nClasses + 1];
+        mpz_t childArrivals[n + 1];
+        RowClass childRows[2 * nClasses];
+        for (int j = 0; j <= nClasses; j += 1) {
+            mpz_init(ways[j]);
+        }
+        mpz_set_ui(ways[0], 1);
+        for (int t = 0; t <= n; t += 1) {
+            mpz_init(childArrivals[t]);
+        }
+        node.ways = ways;
+        node.childRows = childRows;
+        node.childArrivals = childArrivals;
+        node.extend = true;
+        SpanChoose(S, &node, 0, S->s);
+
+        for (int j = 0; j <= nClasses; j += 1) {
+            mpz_clear(ways[j]);
+        }
+        for (int t = 0; t <= n; t += 1) {
+            mpz_clear(childArrivals[t]);
+        }
+    }
+
+    for (int t = 0; t <= n; t += 1) {
+        mpz_clear(current[t]);
+    }
+}
+
+
+// Count the matrices of each rank by going through the chains of independent columns (see above)
+// Assumes min(m,n) <= MAX_SPAN_RANK
+void CountRanksBySpan (int m, int n, int s, mpz_t *ranks) {
+    SpanSearch S = {m, n, s};
+    S.ranks = ranks;
+    S.binoms = (mpz_t*)malloc(sizeof(mpz_t) * (m + 1) * (s + 1));
+    for (int i = 0; i <= m; i += 1) {
+        for (int j = 0; j <= s; j += 1) {
+            mpz_init(S.binoms[i * (s + 1) + j]);
+            mpz_bin_uiui(S.binoms[i * (s + 1) + j], i, j);
+        }
+    }
+    mpz_init(S.columns);
+    mpz_bin_uiui(S.columns, m, s);
+
+    // The empty chain, with all rows in one class
+    RowClass rows[1] = {{0, m}};
+    mpz_t arrivals[n + 1];
+    for (int t = 0; t <= n; t += 1) {
+        mpz_init(arrivals[t]);
+    }
+    mpz_set_ui(arrivals[0], 1);
+    SpanVisit(&S, rows, 1, 0, arrivals);
+
+    for (int t = 0; t <= n; t += 1) {
+        mpz_clear(arrivals[t]);
+    }
+    for (int i = 0; i < (m + 1) * (s + 1); i += 1) {
+        mpz_clear(S.binoms[i]);
+    }
+    free(S.binoms);
+    mpz_clear(S.columns);
+}
+
+
+void PrintUsage (char *progName) {
+    fprintf(stderr, "Usage: %s [-e] [-j threads] [-p prefix] m n s\n", progName);
+    fprintf(stderr, "Count m-by-n binary matrices whose columns have support s\n");
+    fprintf(stderr, "Expects three positive integers m, n, and s (with m at most %d)\n", MAX_ROWS);
+    fprintf(stderr, "  -e          enumerate the matrices instead of their chains of independent columns (much\n");
+    fprintf(stderr, "              slower, for checking; the only way when the rank can be more than %d)\n", MAX_SPAN_RANK);
+    fprintf(stderr, "  -j threads  with -e, number of threads (default 1)\n");
+    fprintf(stderr, "  -p prefix   with -e and more than one thread, hand out the matrices in batches with the same first\n");
+    fprintf(stderr, "              'prefix' columns (default: the fewest columns giving %d batches per thread)\n",
+            PREFIXES_PER_THREAD);
+}
+
+
 int main (int argc, char **argv) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s\n", argv[0]);
-        fprintf(stderr, "Count m-by-n binary matrices whose columns have support s\n");
-        fprintf(stderr, "Expects three positive integers m, n, and s (no bigger than 30 just to be safe)\n.");
+    bool enumerate = false;
+    int nThreads = 1;
+    int prefixLen = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "ej:p:")) != -1) {
+        if (opt == 'e') {
+            enumerate = true;
+        } else if (opt == 'j' && atoi(optarg) > 0) {
+            nThreads = atoi(optarg);
+        } else if (opt == 'p' && atoi(optarg) > 0) {
+            prefixLen = atoi(optarg);
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind != 3) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    int m = atoi(argv[optind]);
+    int n = atoi(argv[optind + 1]);
+    int s = atoi(argv[optind + 2]);
+    if (m < 1 || m > MAX_ROWS || n < 1 || s < 1) {
+        PrintUsage(argv[0]);
         return 1;
     }
-    int m = atoi(argv[1]);
-    int n = atoi(argv[2]);
-    int s = atoi(argv[3]);
     printf("m = %d, n = %d, s = %d\n", m, n, s);
 
     if (s > m) {
@@ -268,29 +877,33 @@ int main (int argc, char **argv) {
     }
 
     int rs = min(m,n) + 1;
-    mpz_t z; // Only used for intermediate computations
     mpz_t *ranks = (mpz_t*)malloc(sizeof(mpz_t) * rs);
 
     // Initialize
-    mpz_init(z);
     for (int r = 0; r < rs; r += 1) {
         mpz_init(ranks[r]);
     }
+    InitBinomials();
 
-    Matrix *M = MatrixCreate(m,n,s);
-    Matrix *N = MatrixCreate(m,n,s);
-
-    do {
-        MatrixCopy(M, N);
-        int r = MatrixRank(N);
-        MatrixConjClassSize(M, &z);
-        mpz_add(ranks[r], ranks[r], z);
-    } while (MatrixIncrement(M));
+    if (!enumerate && min(m,n) > MAX_SPAN_RANK) {
+        fprintf(stderr, "bmcount: the rank can be more than %d, enumerating the matrices instead\n", MAX_SPAN_RANK);
+        enumerate = true;
+    }
 
-    MatrixFree(M);
-    MatrixFree(N);
+    if (!enumerate) {
+        CountRanksBySpan(m, n, s, ranks);
+    } else if (nThreads == 1) {
+        Matrix *M = MatrixCreate(m,n,s);
+        CountRanks(M, 0, ranks);
+        MatrixFree(M);
+    } else {
+        if (prefixLen == 0) {
+            prefixLen = DefaultPrefixLen(m, n, s, (long) PREFIXES_PER_THREAD * nThreads);
+        }
+        CountRanksParallel(m, n, s, nThreads, min(prefixLen, n), ranks, rs);
+    }
 
     for (int r = 0; r < rs; r += 1) {
         gmp_printf("%d: %Zd\n", r, ranks[r]);
     }
-}
\ No newline at end of file
+}
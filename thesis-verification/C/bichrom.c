@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bichrom.h"
+
+/*
+ * Exact two-variable chromatic polynomials from the subset dynamic programming (see bichrom.h)
+ *
+ * For each r, Q_r(y) = sum_m alpha[m][r] (y)_m is expanded with the Stirling numbers of the first kind, and then
+ *  (x-y)^{n-r} Q_r(y) is added to P with the binomial theorem. All of this is done with GMP, but it is nothing
+ *  next to the 3^n steps of the dynamic programming.
+ */
+
+// Most characters (besides the digits of the coefficient) in one term of biChromString, e.g. " - *x^16*y^16"
+#define TERM_MAX_LEN 32
+
+// Per-thread state of biChromRunFile
+typedef struct RunState {
+    BiChromFn fn;
+    void *fnState;
+    Graph g;
+    BiChromPoly p;
+    SubsetTables tables;
+} RunState;
+
+
+void biChromInit (BiChromPoly *p) {
+    p->n = 0;
+    for (int i = 0; i <= BICHROM_MAX_N; i += 1) {
+        for (int j = 0; j <= BICHROM_MAX_N; j += 1) {
+            mpz_init(p->coefs[i][j]);
+        }
+    }
+}
+
+
+void biChromClear (BiChromPoly *p) {
+    for (int i = 0; i <= BICHROM_MAX_N; i += 1) {
+        for (int j = 0; j <= BICHROM_MAX_N; j += 1) {
+            mpz_clear(p->coefs[i][j]);
+        }
+    }
+}
+
+
+// Set z to the unsigned 64-bit integer v
+static void setULL (mpz_t z, unsigned long long v) {
+    mpz_import(z, 1, -1, sizeof(v), 0, 0, &v);
+}
+
+
+void biChromCompute (const Graph *g, BiChromPoly *p, SubsetTables *tables) {
+    int n = g->nVerts;
+    AlphaTable alpha;
+    ensureSubsetTables(tables, n);
+    sumStablePartitions(g, tables, alpha, NULL, n, 0);
+
+    // stirling1[m][b] is the coefficient of y^b in (y)_m (a signed Stirling number of the first kind, at most 15!
+    //  in absolute value)
+    long long stirling1[BICHROM_MAX_N + 1][BICHROM_MAX_N + 1];
+    for (int m = 0; m <= n; m += 1) {
+        for (int b = 0; b <= n; b += 1) {
+            if (m == 0) {
+                stirling1[m][b] = (b == 0);
+            } else {
+                stirling1[m][b] = ((b > 0) ? stirling1[m - 1][b - 1] : 0) - (m - 1) * stirling1[m - 1][b];
+            }
+        }
+    }
+
+    p->n = n;
+    for (int i = 0; i <= BICHROM_MAX_N; i += 1) {
+        for (int j = 0; j <= BICHROM_MAX_N; j += 1) {
+            mpz_set_ui(p->coefs[i][j], 0);
+        }
+    }
+
+    mpz_t q[BICHROM_MAX_N + 1];
+    mpz_t z, term;
+    mpz_init(z);
+    mpz_init(term);
+    for (int b = 0; b <= n; b += 1) {
+        mpz_init(q[b]);
+    }
+    for (int r = 0; r <= n; r += 1) {
+        // q[b] is the coefficient of y^b in Q_r(y)
+        for (int b = 0; b <= r; b += 1) {
+            mpz_set_ui(q[b], 0);
+            for (int m = b; m <= r; m += 1) {
+                setULL(z, alpha[m][r]);
+                mpz_mul_si(z, z, stirling1[m][b]);
+                mpz_add(q[b], q[b], z);
+            }
+        }
+        // (x-y)^d Q_r(y) is the sum of (-1)^{d-i} C(d,i) q[b] x^i y^{d-i+b}
+        int d = n - r;
+        for (int i = 0; i <= d; i += 1) {
+            mpz_bin_uiui(z, d, i);
+            if ((d - i) % 2 == 1) {
+                mpz_neg(z, z);
+            }
+            for (int b = 0; b <= r; b += 1) {
+                mpz_mul(term, z, q[b]);
+                mpz_add(p->coefs[i][d - i + b], p->coefs[i][d - i + b], term);
+            }
+        }
+    }
+    for (int b = 0; b <= n; b += 1) {
+        mpz_clear(q[b]);
+    }
+    mpz_clear(z);
+    mpz_clear(term);
+}
+
+
+void biChromEval (const BiChromPoly *p, long x, long y, mpz_t value) {
+    // Horner's rule in x, with each coefficient (a polynomial in y) also evaluated by Horner's rule
+    mpz_t c;
+    mpz_init(c);
+    mpz_set_ui(value, 0);
+    for (int i = p->n; i >= 0; i -= 1) {
+        mpz_set_ui(c, 0);
+        for (int j = p->n; j >= 0; j -= 1) {
+            mpz_mul_si(c, c, y);
+            mpz_add(c, c, p->coefs[i][j]);
+        }
+        mpz_mul_si(value, value, x);
+        mpz_add(value, value, c);
+    }
+    mpz_clear(c);
+}
+
+
+void biChromBk (const BiChromPoly *p, int k, mpz_t *coefs) {
+    mpz_t binom;
+    mpz_init(binom);
+    for (int j = 0; j <= k; j += 1) {
+        biChromEval(p, k, j, coefs[j]);
+        mpz_bin_uiui(binom, k, j);
+        mpz_mul(coefs[j], coefs[j], binom);
+    }
+    mpz_clear(binom);
+}
+
+
+char *biChromString (const BiChromPoly *p) {
+    size_t cap = TERM_MAX_LEN + 1;
+    for (int i = 0; i <= p->n; i += 1) {
+        for (int j = 0; j <= p->n; j += 1) {
+            cap += mpz_sizeinbase(p->coefs[i][j], 10) + TERM_MAX_LEN;
+        }
+    }
+    char *text = (char*)malloc(cap);
+    size_t len = 0;
+
+    // Terms by decreasing total degree, then decreasing degree in x
+    for (int deg = 2 * p->n; deg >= 0; deg -= 1) {
+        for (int i = (deg < p->n) ? deg : p->n; i >= 0 && deg - i <= p->n; i -= 1) {
+            int j = deg - i;
+            mpz_srcptr c = p->coefs[i][j];
+            int sign = mpz_sgn(c);
+            if (sign == 0) {
+                continue;
+            }
+            if (len > 0) {
+                len += sprintf(&text[len], (sign < 0) ? " - " : " + ");
+            } else if (sign < 0) {
+                len += sprintf(&text[len], "-");
+            }
+
+            // The coefficient (left out when it is 1, unless the term is constant)
+            int isOne = (mpz_cmpabs_ui(c, 1) == 0);
+            if (!isOne || deg == 0) {
+                mpz_get_str(&text[len], 10, c);
+                if (sign < 0) {
+                    memmove(&text[len], &text[len + 1], strlen(&text[len + 1]) + 1);
+                }
+                len += strlen(&text[len]);
+            }
+            const char *sep = (!isOne) ? "*" : "";
+            if (i > 0) {
+                len += (i > 1) ? sprintf(&text[len], "%sx^%d", sep, i) : sprintf(&text[len], "%sx", sep);
+                sep = "*";
+            }
+            if (j > 0) {
+                len += (j > 1) ? sprintf(&text[len], "%sy^%d", sep, j) : sprintf(&text[len], "%sy", sep);
+            }
+        }
+    }
+    if (len == 0) {
+        len += sprintf(&text[len], "0");
+    }
+    return text;
+}
+
+
+// Decode the line and call the state's function with the polynomial of the graph (see biChromRunFile)
+static void processLine (void *arg, const G6Line *line, G6Out *out) {
+    RunState *state = (RunState*)arg;
+    if (line->len == 0) {
+        return;
+    }
+    int err = g6DecodeGraph(line->text, line->len, &state->g);
+    if (err != G6_OK || state->g.nVerts < 1 || state->g.nVerts > BICHROM_MAX_N) {
+        int shown = (line->len < 80) ? (int) line->len : 80;
+        if (err != G6_OK) {
+            fprintf(stderr, "Skipping \"%.*s\": %s\n", shown, line->text, g6ErrorString(err));
+        } else {
+            fprintf(stderr, "Skipping \"%.*s\": graph has %d vertices (must be 1 to %d)\n", shown, line->text,
+                    state->g.nVerts, BICHROM_MAX_N);
+        }
+        return;
+    }
+    biChromCompute(&state->g, &state->p, &state->tables);
+    state->fn(state->fnState, line, &state->g, &state->p, &state->tables, out);
+}
+
+
+int biChromRunFile (int inFd, int outFd, int nThreads, BiChromFn fn, void **states) {
+    RunState *runStates = (RunState*)malloc(sizeof(RunState) * nThreads);
+    void **statePtrs = (void**)malloc(sizeof(void*) * nThreads);
+    for (int t = 0; t < nThreads; t += 1) {
+        runStates[t].fn = fn;
+        runStates[t].fnState = states[t];
+        biChromInit(&runStates[t].p);
+        initSubsetTables(&runStates[t].tables);
+        statePtrs[t] = &runStates[t];
+    }
+
+    int status = g6RunLines(inFd, outFd, nThreads, 1, processLine, statePtrs);
+
+    for (int t = 0; t < nThreads; t += 1) {
+        biChromClear(&runStates[t].p);
+        freeSubsetTables(&runStates[t].tables);
+    }
+    free(statePtrs);
+    free(runStates);
+    return status;
+}
@@ -0,0 +1,65 @@
+#ifndef BICHROM_H
+#define BICHROM_H
+
+#include "gmp-6.1.0/gmp.h" // Change accordingly
+#include "../../graph-utilities/g6pipe.h"
+#include "stable_partitions.h"
+
+/*
+ * The two-variable chromatic polynomial P(G;x,y) of Dohmen, Poenitz, and Tittmann, with exact coefficients
+ *
+ * P(G;x,y) counts the maps from V(G) to {1,...,x} in which each of the colours 1,...,y is used on a stable set.
+ *  Grouping these maps by the set W of vertices given one of the first y colours gives the formula used in
+ *  bivariate_chromatic.sage,
+ *
+ *      P(G;x,y) = sum_{W} (x-y)^{n-|W|} chi(G[W];y) = sum_{r,m} alpha[m][r] (x-y)^{n-r} (y)_m
+ *
+ *  since the chromatic polynomial of G[W] is sum_m a_m(W) (y)_m (see stable_partitions.h). So one pass of the
+ *  subset dynamic programming gives P(G;x,y), instead of a chromatic polynomial for each of the 2^n subsets.
+ * B_k(G) is the polynomial sum_{j=0}^{k} C(k,j) P(G;k,j) y^j (B_k in bivariate_chromatic.sage).
+ */
+
+// Largest number of vertices we handle
+#define BICHROM_MAX_N STABLE_MAX_N
+
+// P(G;x,y) for a graph G on n vertices is the sum of coefs[i][j] x^i y^j over i, j <= n
+typedef struct BiChromPoly {
+    int n;
+    mpz_t coefs[BICHROM_MAX_N + 1][BICHROM_MAX_N + 1];
+} BiChromPoly;
+
+// Function called on each graph by biChromRunFile, which may append output for the graph to 'out'
+// 'line' is the line the graph was read from, and g and p are only valid during the call
+// 'state' is the state of the worker thread making the call, and 'tables' that thread's working space (which fn
+//  may use for its own calls to biChromCompute)
+typedef void (*BiChromFn) (void *state, const G6Line *line, const Graph *g, const BiChromPoly *p,
+                           SubsetTables *tables, G6Out *out);
+
+
+void biChromInit (BiChromPoly *p);
+
+void biChromClear (BiChromPoly *p);
+
+// Set p to P(g;x,y)
+// 'tables' is working space, which can be kept for the next call (see stable_partitions.h)
+// Assumes g has at most BICHROM_MAX_N vertices
+void biChromCompute (const Graph *g, BiChromPoly *p, SubsetTables *tables);
+
+// Set 'value' to P(G;x,y) for the graph G of p
+void biChromEval (const BiChromPoly *p, long x, long y, mpz_t value);
+
+// Set coefs[j] to the coefficient of y^j in B_k(G) for j = 0,...,k, for the graph G of p
+// Assumes coefs has k + 1 initialised entries
+void biChromBk (const BiChromPoly *p, int k, mpz_t *coefs);
+
+// Returns p written out as a polynomial in x and y (e.g. "x^2 - y"), in a string to be freed by the caller
+char *biChromString (const BiChromPoly *p);
+
+// Compute P(G;x,y) for every graph G in the g6 input read from inFd with nThreads threads, calling
+//  fn(states[t], line, G, P, ...) for each (where t is the thread) and writing what it appends to 'out' to outFd
+//  (in the order of the input)
+// Lines which aren't g6 strings of graphs with 1 to BICHROM_MAX_N vertices are skipped (with a message on stderr)
+// Returns 0 on success, or -1 (with errno set) if reading or writing failed
+int biChromRunFile (int inFd, int outFd, int nThreads, BiChromFn fn, void **states);
+
+#endif
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "bichrom.h"
+
+/*
+ * Reads graphs (in g6 format, one per line, with 1 to BICHROM_MAX_N vertices) and prints, for each, its two-variable
+ *  chromatic polynomial P(G;x,y) (see bichrom.h), or the values P(G;k,0),...,P(G;k,k), or the coefficients of
+ *  B_k(G). This does what bivariate_chromatic.sage does, for whole files of graphs.
+ *
+ * Each output line is the g6 string of the graph, a tab, and then either the polynomial (e.g. "x^2 - y" for K2)
+ *  or the numbers, separated by spaces.
+ *
+ * Requires the GNU Multiple Precision Arithmetic Library (GMP)
+ */
+
+#define PRINT_POLY 0
+#define PRINT_VALUES 1
+#define PRINT_BK 2
+
+// What to print (shared by all threads)
+typedef struct Options {
+    int what; // PRINT_POLY, PRINT_VALUES or PRINT_BK
+    int k;
+} Options;
+
+
+// Append the null terminated string s to out
+void outString (G6Out *out, const char *s) {
+    size_t len = strlen(s);
+    memcpy(g6OutReserve(out, len), s, len);
+}
+
+
+// Append the integer z to out
+void outInteger (G6Out *out, mpz_t z) {
+    // Room for the digits (mpz_sizeinbase may give one too many), the sign and the terminating null
+    size_t reserved = mpz_sizeinbase(z, 10) + 2;
+    char *space = g6OutReserve(out, reserved);
+    mpz_get_str(space, 10, z);
+    out->len -= reserved - strlen(space);
+}
+
+
+// Print the line for a graph (see biChromRunFile)
+void printLine (void *state, const G6Line *line, const Graph *g, const BiChromPoly *p, SubsetTables *tables,
+                G6Out *out) {
+    Options *opts = (Options*)state;
+    memcpy(g6OutReserve(out, line->len), line->text, line->len);
+    outString(out, "\t");
+
+    if (opts->what == PRINT_POLY) {
+        char *text = biChromString(p);
+        outString(out, text);
+        free(text);
+    } else {
+        mpz_t values[opts->k + 1];
+        for (int j = 0; j <= opts->k; j += 1) {
+            mpz_init(values[j]);
+        }
+        if (opts->what == PRINT_BK) {
+            biChromBk(p, opts->k, values);
+        } else {
+            for (int j = 0; j <= opts->k; j += 1) {
+                biChromEval(p, opts->k, j, values[j]);
+            }
+        }
+        for (int j = 0; j <= opts->k; j += 1) {
+            if (j > 0) {
+                outString(out, " ");
+            }
+            outInteger(out, values[j]);
+            mpz_clear(values[j]);
+        }
+    }
+    outString(out, "\n");
+}
+
+
+void printUsage (char *progName) {
+    fprintf(stderr, "Usage: %s [-v k | -b k] [-j threads] < graphs.g6\n", progName);
+    fprintf(stderr, "Prints the two-variable chromatic polynomial P(G;x,y) of each graph G (with 1 to %d vertices)\n", BICHROM_MAX_N);
+    fprintf(stderr, "  -v k        print P(G;k,j) for j = 0,...,k instead\n");
+    fprintf(stderr, "  -b k        print the coefficients of y^0,...,y^k in B_k(G) instead\n");
+    fprintf(stderr, "  -j threads  number of worker threads (default 1)\n");
+}
+
+
+int main (int argc, char **argv) {
+    Options opts = {PRINT_POLY, 0};
+    int nThreads = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "v:b:j:")) != -1) {
+        if ((opt == 'v' || opt == 'b') && atoi(optarg) >= 0) {
+            opts.what = (opt == 'v') ? PRINT_VALUES : PRINT_BK;
+            opts.k = atoi(optarg);
+        } else if (opt == 'j' && atoi(optarg) > 0) {
+            nThreads = atoi(optarg);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Every thread only reads the options
+    void *states[nThreads];
+    for (int t = 0; t < nThreads; t += 1) {
+        states[t] = &opts;
+    }
+    if (biChromRunFile(STDIN_FILENO, STDOUT_FILENO, nThreads, printLine, states) < 0) {
+        fprintf(stderr, "ERROR: (bivariate_chromatic) %s\n", strerror(errno));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include "bichrom.h"
+#include "intpoly.h"
+
+/*
+ * Reads graphs (in g6 format, one per line, with 1 to BICHROM_MAX_N vertices) and runs one of the verifications
+ *  of sections 6.3 to 6.5 of the thesis on each, as the Maple scripts do:
+ *
+ *  -s  (bkpoly_sturm.mpl) For k = 1,...,kmax, once repeated roots at -1 are made simple, all roots of B_k(G;y)
+ *      are real, distinct, and at most -1.
+ *  -i  (interlacing.mpl) For each edge uv and k = 1,...,kmax, the roots of B_k(G/uv;y) interlace those of
+ *      k B_k(G-u-v;y) - y B_k'(G-u-v;y).
+ *  -q  (discriminant.mpl) Writing P(G;x,y) = sum_m a_m(x) (y)_m, the discriminant (in y) of
+ *      Q(G;x,y) = sum_m a_m(x) y^m is positive for large x. We also find the largest real root of each
+ *      discriminant, i.e. how large x has to be.
+ *
+ * B_k(G;y) is the coefficient of z^k in the "Z series" 1 / (1 - z Q) of partial_colouring.mpl, where
+ *  Q = exp(sum_v t_v) + y sum_{S stable} t^S, taken at the monomial prod_v t_v. Only the square free monomials
+ *  matter, so Q is the function on vertex subsets S with Q(S) = 1 + y [S stable], and the coefficient is the sum
+ *  over ordered partitions of V(G) into k (possibly empty) blocks of the product of the Q's of the blocks. Grouping
+ *  by the set of blocks counted by y gives B_k(G;y) = sum_j C(k,j) P(G;k,j) y^j, so we get every B_k from the
+ *  subset dynamic programming of bichrom.h. All of this is exact: roots are counted with Sturm sequences and
+ *  interlacing is tested with a Wronskian (see intpoly.c), instead of comparing the approximate roots given by
+ *  fsolve.
+ *
+ * Failures are printed as they are found, one line each (the g6 string of the graph, then what failed), and a
+ *  summary is printed at the end.
+ *
+ * Requires the GNU Multiple Precision Arithmetic Library (GMP)
+ */
+
+#define CHECK_STURM 0
+#define CHECK_INTERLACING 1
+#define CHECK_DISCRIMINANT 2
+
+// Default kmax (for a graph on n vertices) of -s and -i, as in the Maple scripts
+#define STURM_DEFAULT_KMAX(n) ((n) + 1)
+#define INTERLACING_DEFAULT_KMAX(n) ((n) + 2)
+
+// Room for the text of a failure (after the g6 string)
+#define FAILURE_TEXT_LEN 128
+
+// Longest g6 string we remember for the summary of -q (longer ones are cut short)
+#define SUMMARY_G6_LEN 16
+
+// What to check (shared by all threads)
+typedef struct Options {
+    int check; // CHECK_STURM, CHECK_INTERLACING or CHECK_DISCRIMINANT
+    int kmax;  // 0 for the default
+} Options;
+
+// Per-thread state
+typedef struct CheckState {
+    const Options *opts;
+    long graphs;
+    long failures;
+    double largestRoot;                      // largest root of a discriminant so far (for -q)
+    char largestRootG6[SUMMARY_G6_LEN + 1];  // the graph it came from
+    BiChromPoly con;
+    BiChromPoly ext;
+    mpz_t *bkCoefs;
+    int bkCap;
+} CheckState;
+
+
+// Set bk to B_k(G;y), for the graph G of p
+void computeBk (CheckState *state, const BiChromPoly *p, int k, IntPoly *bk) {
+    if (state->bkCap < k + 1) {
+        state->bkCoefs = (mpz_t*)realloc(state->bkCoefs, sizeof(mpz_t) * (k + 1));
+        for (int j = state->bkCap; j < k + 1; j += 1) {
+            mpz_init(state->bkCoefs[j]);
+        }
+        state->bkCap = k + 1;
+    }
+    biChromBk(p, k, state->bkCoefs);
+    polySetCoefs(bk, state->bkCoefs, k);
+}
+
+
+// Append a line for a failure to out: the g6 string of the graph, a tab, and then 'text'
+void printFailure (G6Out *out, const G6Line *line, const char *text) {
+    size_t len = strlen(text);
+    char *space = g6OutReserve(out, line->len + len + 2);
+    memcpy(space, line->text, line->len);
+    space[line->len] = '\t';
+    memcpy(&space[line->len + 1], text, len);
+    space[line->len + 1 + len] = '\n';
+}
+
+
+// Section 6.3: all roots of B_k(G;y) (with any repeated root at -1 made simple) are real, distinct and at most -1
+void checkSturm (CheckState *state, const G6Line *line, const BiChromPoly *p, G6Out *out) {
+    int kmax = (state->opts->kmax > 0) ? state->opts->kmax : STURM_DEFAULT_KMAX(p->n);
+    IntPoly bk;
+    polyInit(&bk);
+    for (int k = 1; k <= kmax; k += 1) {
+        computeBk(state, p, k, &bk);
+        // Once all the factors y + 1 are taken out, there should be deg(B_k) - 1 roots less than -1 if there was
+        //  a root at -1, and deg(B_k) of them otherwise
+        int atMinusOne = (polyRemoveRoot(&bk, -1) > 0);
+        int wanted = bk.deg + atMinusOne;
+        int found = polyRealRootsBelow(&bk, -1) + atMinusOne;
+        if (found != wanted) {
+            char text[FAILURE_TEXT_LEN];
+            sprintf(text, "k = %d -- %d of %d roots are real, distinct and at most -1", k, found, wanted);
+            printFailure(out, line, text);
+            state->failures += 1;
+        }
+    }
+    polyClear(&bk);
+}
+
+
+// Section 6.4: for each edge uv, the roots of B_k(G/uv;y) and k B_k(G-u-v;y) - y B_k'(G-u-v;y) interlace
+void checkInterlacing (CheckState *state, const G6Line *line, const Graph *g, SubsetTables *tables, G6Out *out) {
+    int n = g->nVerts;
+    int kmax = (state->opts->kmax > 0) ? state->opts->kmax : INTERLACING_DEFAULT_KMAX(n);
+    IntPoly con, ext;
+    polyInit(&con);
+    polyInit(&ext);
+    for (int u = 0; u < n; u += 1) {
+        for (VertexSet rest = g->nbrs[u] & ~ALL_VERTICES(u + 1); rest != 0; rest &= rest - 1) {
+            int v = __builtin_ctzll(rest);
+            Graph h;
+            graphContractPair(g, u, v, &h);
+            biChromCompute(&h, &state->con, tables);
+            graphInduced(g, ALL_VERTICES(n) & ~VERTEX_BIT(u) & ~VERTEX_BIT(v), &h);
+            biChromCompute(&h, &state->ext, tables);
+
+            for (int k = 1; k <= kmax; k += 1) {
+                computeBk(state, &state->con, k, &con);
+                // k B - y B' multiplies the coefficient of y^j by k - j
+                computeBk(state, &state->ext, k, &ext);
+                for (int j = 0; j <= k; j += 1) {
+                    mpz_mul_si(state->bkCoefs[j], state->bkCoefs[j], k - j);
+                }
+                polySetCoefs(&ext, state->bkCoefs, k);
+                if (!polyInterlace(&con, &ext)) {
+                    char text[FAILURE_TEXT_LEN];
+                    sprintf(text, "edge = %d-%d -- k = %d -- roots don't interlace", u, v, k);
+                    printFailure(out, line, text);
+                    state->failures += 1;
+                }
+            }
+        }
+    }
+    polyClear(&con);
+    polyClear(&ext);
+}
+
+
+// Section 6.5: the discriminant of Q(G;x,y) in y is positive for large x
+void checkDiscriminant (CheckState *state, const G6Line *line, const BiChromPoly *p, G6Out *out) {
+    int n = p->n;
+    // stirling2[b][m] is the number of partitions of b things into m parts, so y^b = sum_m stirling2[b][m] (y)_m
+    unsigned long long stirling2[BICHROM_MAX_N + 1][BICHROM_MAX_N + 1];
+    for (int b = 0; b <= n; b += 1) {
+        for (int m = 0; m <= n; m += 1) {
+            if (b == 0) {
+                stirling2[b][m] = (m == 0);
+            } else {
+                stirling2[b][m] = ((m > 0) ? stirling2[b - 1][m - 1] : 0) + m * stirling2[b - 1][m];
+            }
+        }
+    }
+
+    // coefs[m] = a_m(x) = sum_b stirling2[b][m] (coefficient of y^b in P)
+    IntPoly coefs[BICHROM_MAX_N + 1];
+    IntPoly disc;
+    mpz_t xCoefs[BICHROM_MAX_N + 1];
+    for (int i = 0; i <= n; i += 1) {
+        mpz_init(xCoefs[i]);
+    }
+    polyInit(&disc);
+    int d = -1;
+    for (int m = 0; m <= n; m += 1) {
+        for (int i = 0; i <= n; i += 1) {
+            mpz_set_ui(xCoefs[i], 0);
+            for (int b = m; b <= n; b += 1) {
+                mpz_addmul_ui(xCoefs[i], p->coefs[i][b], stirling2[b][m]);
+            }
+        }
+        polyInit(&coefs[m]);
+        polySetCoefs(&coefs[m], xCoefs, n);
+        if (coefs[m].deg >= 0) {
+            d = m;
+        }
+    }
+
+    // Nothing to check when Q has degree at most 1 in y
+    if (d >= 2) {
+        polyDiscriminant(&disc, coefs, d);
+        if (polySignAtInfinity(&disc, 1) <= 0) {
+            char text[FAILURE_TEXT_LEN];
+            sprintf(text, "discriminant of Q (degree %d in y) is not positive for large x", d);
+            printFailure(out, line, text);
+            state->failures += 1;
+        } else {
+            double root = polyLargestRoot(&disc);
+            if (root > state->largestRoot) {
+                state->largestRoot = root;
+                int len = (line->len < SUMMARY_G6_LEN) ? (int) line->len : SUMMARY_G6_LEN;
+                memcpy(state->largestRootG6, line->text, len);
+                state->largestRootG6[len] = '\0';
+            }
+        }
+    }
+
+    for (int m = 0; m <= n; m += 1) {
+        polyClear(&coefs[m]);
+    }
+    for (int i = 0; i <= n; i += 1) {
+        mpz_clear(xCoefs[i]);
+    }
+    polyClear(&disc);
+}
+
+
+// Check a graph (see biChromRunFile)
+void checkGraph (void *arg, const G6Line *line, const Graph *g, const BiChromPoly *p, SubsetTables *tables,
+                 G6Out *out) {
+    CheckState *state = (CheckState*)arg;
+    state->graphs += 1;
+    if (state->opts->check == CHECK_STURM) {
+        checkSturm(state, line, p, out);
+    } else if (state->opts->check == CHECK_INTERLACING) {
+        checkInterlacing(state, line, g, tables, out);
+    } else {
+        checkDiscriminant(state, line, p, out);
+    }
+}
+
+
+void printUsage (char *progName) {
+    fprintf(stderr, "Usage: %s [-s | -i | -q] [-k kmax] [-j threads] < graphs.g6\n", progName);
+    fprintf(stderr, "Checks each graph G (with 1 to %d vertices), printing the ones which fail\n", BICHROM_MAX_N);
+    fprintf(stderr, "  -s          roots of B_k(G;y) are real and at most -1 (default)\n");
+    fprintf(stderr, "  -i          roots of B_k(G/e;y) and k B_k(G-u-v;y) - y B_k'(G-u-v;y) interlace, for each edge e = uv\n");
+    fprintf(stderr, "  -q          discriminant of Q(G;x,y) (in y) is positive for large x\n");
+    fprintf(stderr, "  -k kmax     check k = 1,...,kmax (default n + 1 for -s and n + 2 for -i, for G on n vertices)\n");
+    fprintf(stderr, "  -j threads  number of worker threads (default 1)\n");
+}
+
+
+int main (int argc, char **argv) {
+    Options opts = {CHECK_STURM, 0};
+    int nThreads = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "siqk:j:")) != -1) {
+        if (opt == 's') {
+            opts.check = CHECK_STURM;
+        } else if (opt == 'i') {
+            opts.check = CHECK_INTERLACING;
+        } else if (opt == 'q') {
+            opts.check = CHECK_DISCRIMINANT;
+        } else if (opt == 'k' && atoi(optarg) > 0) {
+            opts.kmax = atoi(optarg);
+        } else if (opt == 'j' && atoi(optarg) > 0) {
+            nThreads = atoi(optarg);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    CheckState *states = (CheckState*)malloc(sizeof(CheckState) * nThreads);
+    void *statePtrs[nThreads];
+    for (int t = 0; t < nThreads; t += 1) {
+        states[t].opts = &opts;
+        states[t].graphs = 0;
+        states[t].failures = 0;
+        states[t].largestRoot = -HUGE_VAL;
+        states[t].largestRootG6[0] = '\0';
+        biChromInit(&states[t].con);
+        biChromInit(&states[t].ext);
+        states[t].bkCoefs = NULL;
+        states[t].bkCap = 0;
+        statePtrs[t] = &states[t];
+    }
+
+    int status = biChromRunFile(STDIN_FILENO, STDOUT_FILENO, nThreads, checkGraph, statePtrs);
+    if (status < 0) {
+        fprintf(stderr, "ERROR: (bkpoly_check) %s\n", strerror(errno));
+    }
+
+    long graphs = 0;
+    long failures = 0;
+    CheckState *largest = &states[0];
+    for (int t = 0; t < nThreads; t += 1) {
+        graphs += states[t].graphs;
+        failures += states[t].failures;
+        if (states[t].largestRoot > largest->largestRoot) {
+            largest = &states[t];
+        }
+    }
+    printf("Checked %ld graphs: %ld failures\n", graphs, failures);
+    if (opts.check == CHECK_DISCRIMINANT && largest->largestRoot > -HUGE_VAL) {
+        printf("Largest root of a discriminant: %.6f (%s)\n", largest->largestRoot, largest->largestRootG6);
+    }
+
+    for (int t = 0; t < nThreads; t += 1) {
+        biChromClear(&states[t].con);
+        biChromClear(&states[t].ext);
+        for (int j = 0; j < states[t].bkCap; j += 1) {
+            mpz_clear(states[t].bkCoefs[j]);
+        }
+        free(states[t].bkCoefs);
+    }
+    free(states);
+    return (status < 0) ? 1 : 0;
+}
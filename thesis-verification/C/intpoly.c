@@ -0,0 +1,594 @@
+#include <stdlib.h>
+#include <math.h>
+#include "intpoly.h"
+
+/*
+ * Integer polynomials and Sturm sequences (see intpoly.h)
+ *
+ * Everything is done with exact integer arithmetic: remainders are replaced by pseudo-remainders (made primitive
+ *  at every step so the coefficients stay small), and signs are evaluated at dyadic points by clearing the
+ *  denominators. The polynomials we work with have degree at most about 60, so the simple quadratic algorithms
+ *  are all we need.
+ */
+
+// Number of bisection steps in polyLargestRoot past the point where the root is within 1 of the bound
+#define ROOT_BISECTIONS 40
+
+
+// Make room for at least cap coefficients in p
+static void polyReserve (IntPoly *p, int cap) {
+    if (p->cap < cap) {
+        p->coefs = (mpz_t*)realloc(p->coefs, sizeof(mpz_t) * cap);
+        for (int i = p->cap; i < cap; i += 1) {
+            mpz_init(p->coefs[i]);
+        }
+        p->cap = cap;
+    }
+}
+
+
+// Set p->deg to the degree of p, given that all its coefficients past 'deg' are zero
+static void polyNormalise (IntPoly *p, int deg) {
+    while (deg >= 0 && mpz_sgn(p->coefs[deg]) == 0) {
+        deg -= 1;
+    }
+    p->deg = deg;
+}
+
+
+void polyInit (IntPoly *p) {
+    p->deg = -1;
+    p->cap = 0;
+    p->coefs = NULL;
+}
+
+
+void polyClear (IntPoly *p) {
+    for (int i = 0; i < p->cap; i += 1) {
+        mpz_clear(p->coefs[i]);
+    }
+    free(p->coefs);
+}
+
+
+void polySetCoefs (IntPoly *p, mpz_t *coefs, int deg) {
+    polyReserve(p, deg + 1);
+    for (int i = 0; i <= deg; i += 1) {
+        mpz_set(p->coefs[i], coefs[i]);
+    }
+    polyNormalise(p, deg);
+}
+
+
+void polyCopy (IntPoly *r, const IntPoly *a) {
+    if (r != a) {
+        polySetCoefs(r, a->coefs, a->deg);
+    }
+}
+
+
+// r = a + sign * b
+static void polyAddSigned (IntPoly *r, const IntPoly *a, const IntPoly *b, int sign) {
+    int deg = (a->deg > b->deg) ? a->deg : b->deg;
+    // Reserving may move the coefficients of r, which could be those of a or b
+    IntPoly *aliased = (r == a || r == b) ? r : NULL;
+    polyReserve(r, deg + 1);
+    if (aliased != NULL) {
+        a = (a == aliased) ? r : a;
+        b = (b == aliased) ? r : b;
+    }
+    for (int i = 0; i <= deg; i += 1) {
+        if (i > b->deg) {
+            mpz_set(r->coefs[i], a->coefs[i]);
+        } else if (i > a->deg) {
+            if (sign > 0) {
+                mpz_set(r->coefs[i], b->coefs[i]);
+            } else {
+                mpz_neg(r->coefs[i], b->coefs[i]);
+            }
+        } else if (sign > 0) {
+            mpz_add(r->coefs[i], a->coefs[i], b->coefs[i]);
+        } else {
+            mpz_sub(r->coefs[i], a->coefs[i], b->coefs[i]);
+        }
+    }
+    polyNormalise(r, deg);
+}
+
+
+void polyAdd (IntPoly *r, const IntPoly *a, const IntPoly *b) {
+    polyAddSigned(r, a, b, 1);
+}
+
+
+void polySub (IntPoly *r, const IntPoly *a, const IntPoly *b) {
+    polyAddSigned(r, a, b, -1);
+}
+
+
+void polyMul (IntPoly *r, const IntPoly *a, const IntPoly *b) {
+    if (a->deg < 0 || b->deg < 0) {
+        r->deg = -1;
+        return;
+    }
+    int deg = a->deg + b->deg;
+    polyReserve(r, deg + 1);
+    for (int i = 0; i <= deg; i += 1) {
+        mpz_set_ui(r->coefs[i], 0);
+    }
+    for (int i = 0; i <= a->deg; i += 1) {
+        for (int j = 0; j <= b->deg; j += 1) {
+            mpz_addmul(r->coefs[i + j], a->coefs[i], b->coefs[j]);
+        }
+    }
+    r->deg = deg;
+}
+
+
+void polyMulScalar (IntPoly *r, const IntPoly *a, long c) {
+    polyCopy(r, a);
+    for (int i = 0; i <= r->deg; i += 1) {
+        mpz_mul_si(r->coefs[i], r->coefs[i], c);
+    }
+    polyNormalise(r, r->deg);
+}
+
+
+void polyDerivative (IntPoly *r, const IntPoly *a) {
+    polyCopy(r, a);
+    for (int i = 1; i <= r->deg; i += 1) {
+        mpz_mul_ui(r->coefs[i - 1], r->coefs[i], i);
+    }
+    polyNormalise(r, r->deg - 1);
+}
+
+
+void polyPrimitive (IntPoly *p) {
+    if (p->deg < 0) {
+        return;
+    }
+    mpz_t content;
+    mpz_init(content);
+    for (int i = 0; i <= p->deg && mpz_cmp_ui(content, 1) != 0; i += 1) {
+        mpz_gcd(content, content, p->coefs[i]);
+    }
+    if (mpz_cmp_ui(content, 1) != 0) {
+        for (int i = 0; i <= p->deg; i += 1) {
+            mpz_divexact(p->coefs[i], p->coefs[i], content);
+        }
+    }
+    mpz_clear(content);
+}
+
+
+// Replace r by a positive multiple of its remainder on division by b, made primitive
+// Assumes b is not zero
+static void polyPseudoRem (IntPoly *r, const IntPoly *b) {
+    mpz_t lead, scale;
+    mpz_init(lead);
+    mpz_init(scale);
+    // Each step is r = |lc(b)| r - sign(lc(b)) lc(r) x^shift b, which cancels the leading term of r
+    mpz_abs(scale, b->coefs[b->deg]);
+    int sign = mpz_sgn(b->coefs[b->deg]);
+    while (r->deg >= b->deg) {
+        int shift = r->deg - b->deg;
+        mpz_set(lead, r->coefs[r->deg]);
+        if (sign < 0) {
+            mpz_neg(lead, lead);
+        }
+        for (int i = 0; i <= r->deg; i += 1) {
+            mpz_mul(r->coefs[i], r->coefs[i], scale);
+        }
+        for (int i = 0; i <= b->deg; i += 1) {
+            mpz_submul(r->coefs[i + shift], lead, b->coefs[i]);
+        }
+        polyNormalise(r, r->deg - 1);
+        polyPrimitive(r);
+    }
+    mpz_clear(lead);
+    mpz_clear(scale);
+}
+
+
+void polyDivExact (IntPoly *r, const IntPoly *a, const IntPoly *b) {
+    if (a->deg < b->deg) {
+        r->deg = -1;
+        return;
+    }
+    IntPoly rem;
+    polyInit(&rem);
+    polyCopy(&rem, a);
+    int deg = a->deg - b->deg;
+    polyReserve(r, deg + 1);
+    for (int i = deg; i >= 0; i -= 1) {
+        mpz_divexact(r->coefs[i], rem.coefs[i + b->deg], b->coefs[b->deg]);
+        for (int j = 0; j <= b->deg; j += 1) {
+            mpz_submul(rem.coefs[i + j], r->coefs[i], b->coefs[j]);
+        }
+    }
+    r->deg = deg;
+    polyClear(&rem);
+}
+
+
+void polyGcd (IntPoly *r, const IntPoly *a, const IntPoly *b) {
+    IntPoly u, v;
+    polyInit(&u);
+    polyInit(&v);
+    polyCopy(&u, a);
+    polyCopy(&v, b);
+    polyPrimitive(&u);
+    polyPrimitive(&v);
+    // Euclid's algorithm, with u the last non-zero remainder
+    while (v.deg >= 0) {
+        polyPseudoRem(&u, &v);
+        IntPoly tmp = u;
+        u = v;
+        v = tmp;
+    }
+    polyCopy(r, &u);
+    if (mpz_sgn(r->coefs[r->deg]) < 0) {
+        polyMulScalar(r, r, -1);
+    }
+    polyClear(&u);
+    polyClear(&v);
+}
+
+
+void polySquarefree (IntPoly *r, const IntPoly *p) {
+    IntPoly dp, g;
+    polyInit(&dp);
+    polyInit(&g);
+    polyDerivative(&dp, p);
+    polyGcd(&g, p, &dp);
+    polyDivExact(r, p, &g);
+    polyPrimitive(r);
+    polyClear(&dp);
+    polyClear(&g);
+}
+
+
+int polyRemoveRoot (IntPoly *p, long c) {
+    mpz_t carry;
+    mpz_init(carry);
+    int mult = 0;
+    while (p->deg > 0) {
+        // Synthetic division by (x - c): the quotient's coefficients are the partial sums of Horner's rule,
+        //  and the last one is p(c)
+        mpz_set_ui(carry, 0);
+        for (int i = p->deg; i >= 0; i -= 1) {
+            mpz_mul_si(carry, carry, c);
+            mpz_add(carry, carry, p->coefs[i]);
+        }
+        if (mpz_sgn(carry) != 0) {
+            break;
+        }
+        mpz_set_ui(carry, 0);
+        for (int i = p->deg; i >= 0; i -= 1) {
+            mpz_mul_si(carry, carry, c);
+            mpz_add(carry, carry, p->coefs[i]);
+            mpz_set(p->coefs[i], carry);
+        }
+        // Now coefs[i] holds the coefficient of x^{i-1} in the quotient (and coefs[0] the remainder, 0)
+        for (int i = 0; i < p->deg; i += 1) {
+            mpz_swap(p->coefs[i], p->coefs[i + 1]);
+        }
+        p->deg -= 1;
+        mult += 1;
+    }
+    mpz_clear(carry);
+    return mult;
+}
+
+
+int polySign (const IntPoly *p, const mpz_t num, int exp) {
+    if (p->deg < 0) {
+        return 0;
+    }
+    // 2^(exp deg) p(num / 2^exp) = sum_i coefs[i] num^i 2^(exp (deg - i)), by Horner's rule
+    mpz_t value, term;
+    mpz_init_set(value, p->coefs[p->deg]);
+    mpz_init(term);
+    for (int i = p->deg - 1; i >= 0; i -= 1) {
+        mpz_mul(value, value, num);
+        mpz_mul_2exp(term, p->coefs[i], (unsigned long) exp * (p->deg - i));
+        mpz_add(value, value, term);
+    }
+    int sign = mpz_sgn(value);
+    mpz_clear(value);
+    mpz_clear(term);
+    return sign;
+}
+
+
+int polySignAtInfinity (const IntPoly *p, int dir) {
+    if (p->deg < 0) {
+        return 0;
+    }
+    int sign = mpz_sgn(p->coefs[p->deg]);
+    return (dir < 0 && p->deg % 2 == 1) ? -sign : sign;
+}
+
+
+void polyDiscriminant (IntPoly *disc, IntPoly *coefs, int d) {
+    // disc = (-1)^(d(d-1)/2) Res(F, F') / a_d, where the resultant is the determinant of the Sylvester matrix of
+    //  F = sum_j coefs[j] y^j and F' (d - 1 rows of shifted coefficients of F, then d rows of those of F'), which
+    //  we find by fraction-free (Bareiss) elimination, with polynomials in x as entries
+    int size = 2 * d - 1;
+    IntPoly *m = (IntPoly*)malloc(sizeof(IntPoly) * size * size);
+    for (int i = 0; i < size * size; i += 1) {
+        polyInit(&m[i]);
+    }
+    for (int row = 0; row < d - 1; row += 1) {
+        for (int j = 0; j <= d; j += 1) {
+            polyCopy(&m[row * size + row + j], &coefs[d - j]);
+        }
+    }
+    for (int row = 0; row < d; row += 1) {
+        for (int j = 0; j < d; j += 1) {
+            polyMulScalar(&m[(d - 1 + row) * size + row + j], &coefs[d - j], d - j);
+        }
+    }
+
+    IntPoly prev, t1, t2;
+    polyInit(&prev);
+    polyInit(&t1);
+    polyInit(&t2);
+    polyReserve(&prev, 1);
+    mpz_set_ui(prev.coefs[0], 1);
+    prev.deg = 0;
+    int sign = ((d * (d - 1) / 2) % 2 == 0) ? 1 : -1;
+    int singular = 0;
+    for (int k = 0; k < size - 1 && !singular; k += 1) {
+        if (m[k * size + k].deg < 0) {
+            int pivot = k + 1;
+            while (pivot < size && m[pivot * size + k].deg < 0) {
+                pivot += 1;
+            }
+            if (pivot == size) {
+                singular = 1;
+                break;
+            }
+            for (int j = 0; j < size; j += 1) {
+                IntPoly tmp = m[k * size + j];
+                m[k * size + j] = m[pivot * size + j];
+                m[pivot * size + j] = tmp;
+            }
+            sign = -sign;
+        }
+        for (int i = k + 1; i < size; i += 1) {
+            for (int j = k + 1; j < size; j += 1) {
+                polyMul(&t1, &m[k * size + k], &m[i * size + j]);
+                polyMul(&t2, &m[i * size + k], &m[k * size + j]);
+                polySub(&t1, &t1, &t2);
+                polyDivExact(&m[i * size + j], &t1, &prev);
+            }
+        }
+        polyCopy(&prev, &m[k * size + k]);
+    }
+
+    if (singular) {
+        disc->deg = -1;
+    } else {
+        polyDivExact(disc, &m[size * size - 1], &coefs[d]);
+        if (sign < 0) {
+            polyMulScalar(disc, disc, -1);
+        }
+    }
+
+    for (int i = 0; i < size * size; i += 1) {
+        polyClear(&m[i]);
+    }
+    free(m);
+    polyClear(&prev);
+    polyClear(&t1);
+    polyClear(&t2);
+}
+
+
+void sturmInit (SturmSeq *seq) {
+    seq->len = 0;
+    seq->cap = 0;
+    seq->polys = NULL;
+}
+
+
+void sturmClear (SturmSeq *seq) {
+    for (int i = 0; i < seq->cap; i += 1) {
+        polyClear(&seq->polys[i]);
+    }
+    free(seq->polys);
+}
+
+
+void sturmCompute (SturmSeq *seq, const IntPoly *p) {
+    // There are at most deg(p) + 1 polynomials in the sequence, plus the zero remainder which ends it
+    if (seq->cap < p->deg + 2) {
+        seq->polys = (IntPoly*)realloc(seq->polys, sizeof(IntPoly) * (p->deg + 2));
+        for (int i = seq->cap; i < p->deg + 2; i += 1) {
+            polyInit(&seq->polys[i]);
+        }
+        seq->cap = p->deg + 2;
+    }
+    polyCopy(&seq->polys[0], p);
+    polyPrimitive(&seq->polys[0]);
+    seq->len = 1;
+    if (p->deg < 1) {
+        return;
+    }
+    polyDerivative(&seq->polys[1], &seq->polys[0]);
+    polyPrimitive(&seq->polys[1]);
+    seq->len = 2;
+    while (1) {
+        IntPoly *next = &seq->polys[seq->len];
+        polyCopy(next, &seq->polys[seq->len - 2]);
+        polyPseudoRem(next, &seq->polys[seq->len - 1]);
+        if (next->deg < 0) {
+            break;
+        }
+        polyMulScalar(next, next, -1);
+        seq->len += 1;
+    }
+}
+
+
+// Number of sign changes in the signs signs[0],...,signs[len-1], skipping zeros
+static int countVariations (const int *signs, int len) {
+    int variations = 0;
+    int last = 0;
+    for (int i = 0; i < len; i += 1) {
+        if (signs[i] != 0) {
+            variations += (last != 0 && signs[i] != last);
+            last = signs[i];
+        }
+    }
+    return variations;
+}
+
+
+int sturmVariations (const SturmSeq *seq, const mpz_t num, int exp) {
+    int signs[seq->len];
+    for (int i = 0; i < seq->len; i += 1) {
+        signs[i] = polySign(&seq->polys[i], num, exp);
+    }
+    return countVariations(signs, seq->len);
+}
+
+
+int sturmVariationsAtInfinity (const SturmSeq *seq, int dir) {
+    int signs[seq->len];
+    for (int i = 0; i < seq->len; i += 1) {
+        signs[i] = polySignAtInfinity(&seq->polys[i], dir);
+    }
+    return countVariations(signs, seq->len);
+}
+
+
+int polyRealRoots (const IntPoly *p) {
+    SturmSeq seq;
+    sturmInit(&seq);
+    sturmCompute(&seq, p);
+    int roots = sturmVariationsAtInfinity(&seq, -1) - sturmVariationsAtInfinity(&seq, 1);
+    sturmClear(&seq);
+    return roots;
+}
+
+
+int polyRealRootsBelow (const IntPoly *p, long c) {
+    // Sturm's theorem counts the roots in (-infinity, c], as long as c isn't a multiple root, so we use the
+    //  square free part of p and leave out c if it is a root
+    IntPoly s;
+    SturmSeq seq;
+    mpz_t point;
+    polyInit(&s);
+    sturmInit(&seq);
+    mpz_init_set_si(point, c);
+    polySquarefree(&s, p);
+    sturmCompute(&seq, &s);
+    int roots = sturmVariationsAtInfinity(&seq, -1) - sturmVariations(&seq, point, 0);
+    roots -= (polySign(&s, point, 0) == 0);
+    mpz_clear(point);
+    sturmClear(&seq);
+    polyClear(&s);
+    return roots;
+}
+
+
+// Returns 1 if p has only real roots, 0 otherwise
+static int polyRealRooted (const IntPoly *p) {
+    // The roots of p are those of its square free part s, which are all real exactly when s has deg(s) of them
+    IntPoly s;
+    polyInit(&s);
+    polySquarefree(&s, p);
+    int realRooted = (polyRealRoots(&s) == s.deg);
+    polyClear(&s);
+    return realRooted;
+}
+
+
+int polyInterlace (const IntPoly *p, const IntPoly *q) {
+    if (!polyRealRooted(p) || !polyRealRooted(q)) {
+        return 0;
+    }
+    // Common roots can be put anywhere, so take them out: p = h p1 and q = h q1 (with h = gcd(p,q)) interlace
+    //  exactly when p1 and q1 do. Since p1 and q1 have no common roots, that is when they strictly interlace, which
+    //  (for real rooted polynomials) is when their Wronskian p1'q1 - p1q1' has no real roots. The Wronskian is
+    //  only zero when p1 and q1 are both constants.
+    IntPoly h, p1, q1, dp, dq, w, t;
+    polyInit(&h);
+    polyInit(&p1);
+    polyInit(&q1);
+    polyInit(&dp);
+    polyInit(&dq);
+    polyInit(&w);
+    polyInit(&t);
+    polyGcd(&h, p, q);
+    polyDivExact(&p1, p, &h);
+    polyDivExact(&q1, q, &h);
+    polyDerivative(&dp, &p1);
+    polyDerivative(&dq, &q1);
+    polyMul(&w, &dp, &q1);
+    polyMul(&t, &p1, &dq);
+    polySub(&w, &w, &t);
+    int interlace = (w.deg < 0 || polyRealRoots(&w) == 0);
+    polyClear(&h);
+    polyClear(&p1);
+    polyClear(&q1);
+    polyClear(&dp);
+    polyClear(&dq);
+    polyClear(&w);
+    polyClear(&t);
+    return interlace;
+}
+
+
+double polyLargestRoot (const IntPoly *p) {
+    IntPoly s;
+    SturmSeq seq;
+    polyInit(&s);
+    sturmInit(&seq);
+    polySquarefree(&s, p);
+    sturmCompute(&seq, &s);
+    int atInfinity = sturmVariationsAtInfinity(&seq, 1);
+    double root = -HUGE_VAL;
+
+    if (sturmVariationsAtInfinity(&seq, -1) > atInfinity) {
+        // Every root is less than 1 + max_i |coefs[i] / coefs[deg]| <= 2^bound in absolute value (Cauchy)
+        int bound = 1;
+        for (int i = 0; i < s.deg; i += 1) {
+            int bits = (int) mpz_sizeinbase(s.coefs[i], 2) - (int) mpz_sizeinbase(s.coefs[s.deg], 2) + 2;
+            bound = (bits > bound) ? bits : bound;
+        }
+        // Bisect, keeping the largest root in (lo / 2^exp, hi / 2^exp]
+        mpz_t lo, hi, mid;
+        mpz_init_set_si(lo, -1);
+        mpz_init_set_si(hi, 1);
+        mpz_init(mid);
+        mpz_mul_2exp(lo, lo, bound);
+        mpz_mul_2exp(hi, hi, bound);
+        int exp = 0;
+        for (int step = 0; step < 2 * bound + ROOT_BISECTIONS; step += 1) {
+            mpz_add(mid, lo, hi);
+            if (mpz_odd_p(mid)) {
+                mpz_mul_2exp(lo, lo, 1);
+                mpz_mul_2exp(hi, hi, 1);
+                mpz_mul_2exp(mid, mid, 1);
+                exp += 1;
+            }
+            mpz_fdiv_q_2exp(mid, mid, 1);
+            if (sturmVariations(&seq, mid, exp) > atInfinity) {
+                mpz_set(lo, mid);
+            } else {
+                mpz_set(hi, mid);
+            }
+        }
+        root = ldexp(mpz_get_d(hi), -exp);
+        mpz_clear(lo);
+        mpz_clear(hi);
+        mpz_clear(mid);
+    }
+
+    sturmClear(&seq);
+    polyClear(&s);
+    return root;
+}
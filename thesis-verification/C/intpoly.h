@@ -0,0 +1,117 @@
+#ifndef INTPOLY_H
+#define INTPOLY_H
+
+#include "gmp-6.1.0/gmp.h" // Change accordingly
+
+/*
+ * Polynomials in one variable with (GMP) integer coefficients, and exact real root counting with Sturm sequences
+ *
+ * This is what the Maple verifications use sturm, fsolve and discrim for. Since we only care about where the
+ *  roots are, most functions are only defined up to a positive constant factor: gcd's are primitive (the gcd of
+ *  their coefficients is 1), and pseudo-remainders are positive multiples of the remainder. Points on the real
+ *  line are given as dyadic rationals num / 2^exp.
+ */
+
+// The sum of coefs[i] x^i for i = 0,...,deg, with coefs[deg] != 0 (the zero polynomial has deg = -1)
+// coefs has room for cap coefficients (all initialised)
+typedef struct IntPoly {
+    int deg;
+    int cap;
+    mpz_t *coefs;
+} IntPoly;
+
+// Sturm sequence p_0 = p, p_1 = p', p_{i+1} = -rem(p_{i-1}, p_i), ..., of a polynomial p (up to positive factors)
+typedef struct SturmSeq {
+    int len;
+    int cap;
+    IntPoly *polys;
+} SturmSeq;
+
+
+// Start with the zero polynomial
+void polyInit (IntPoly *p);
+
+void polyClear (IntPoly *p);
+
+// Set p to the polynomial with the coefficients coefs[0],...,coefs[deg] (in increasing degree)
+void polySetCoefs (IntPoly *p, mpz_t *coefs, int deg);
+
+void polyCopy (IntPoly *r, const IntPoly *a);
+
+// r = a + b (r may be a or b)
+void polyAdd (IntPoly *r, const IntPoly *a, const IntPoly *b);
+
+// r = a - b (r may be a or b)
+void polySub (IntPoly *r, const IntPoly *a, const IntPoly *b);
+
+// r = a * b (r must not be a or b)
+void polyMul (IntPoly *r, const IntPoly *a, const IntPoly *b);
+
+// r = c * a (r may be a)
+void polyMulScalar (IntPoly *r, const IntPoly *a, long c);
+
+// r = a' (r may be a)
+void polyDerivative (IntPoly *r, const IntPoly *a);
+
+// Divide p by the gcd of its coefficients (leaving its sign alone)
+void polyPrimitive (IntPoly *p);
+
+// r = a / b, assuming b divides a (with an integer quotient)
+// r must not be a or b
+void polyDivExact (IntPoly *r, const IntPoly *a, const IntPoly *b);
+
+// r = gcd(a, b), primitive and with a positive leading coefficient (r must not be a or b)
+// Assumes a and b are not both zero
+void polyGcd (IntPoly *r, const IntPoly *a, const IntPoly *b);
+
+// r = p / gcd(p, p'), the product of the distinct irreducible factors of p (r must not be p)
+// Assumes p is not zero
+void polySquarefree (IntPoly *r, const IntPoly *p);
+
+// Returns the multiplicity of the integer c as a root of p, and divides p by (x - c) that many times
+// Assumes p is not zero
+int polyRemoveRoot (IntPoly *p, long c);
+
+// Returns the sign (-1, 0 or 1) of p at num / 2^exp
+int polySign (const IntPoly *p, const mpz_t num, int exp);
+
+// Returns the sign of p(x) as x tends to 'dir' * infinity (dir is -1 or 1)
+int polySignAtInfinity (const IntPoly *p, int dir);
+
+// Set disc to the discriminant (with respect to y) of the polynomial sum_{j=0}^{d} coefs[j] y^j, whose
+//  coefficients coefs[j] are polynomials in x (disc is then a polynomial in x)
+// Assumes d >= 1 and coefs[d] is not zero
+void polyDiscriminant (IntPoly *disc, IntPoly *coefs, int d);
+
+
+void sturmInit (SturmSeq *seq);
+
+void sturmClear (SturmSeq *seq);
+
+// Set seq to the Sturm sequence of p
+// Assumes p is not zero
+void sturmCompute (SturmSeq *seq, const IntPoly *p);
+
+// Number of sign changes in the sequence at num / 2^exp (zeros are skipped)
+int sturmVariations (const SturmSeq *seq, const mpz_t num, int exp);
+
+// Number of sign changes in the sequence at 'dir' * infinity
+int sturmVariationsAtInfinity (const SturmSeq *seq, int dir);
+
+// Returns the number of distinct real roots of p
+// Assumes p is not zero
+int polyRealRoots (const IntPoly *p);
+
+// Returns the number of distinct real roots of p less than the integer c
+// Assumes p is not zero
+int polyRealRootsBelow (const IntPoly *p, long c);
+
+// Returns 1 if p and q have only real roots and their roots interlace (equal roots are allowed), 0 otherwise
+// Assumes p and q are not zero
+int polyInterlace (const IntPoly *p, const IntPoly *q);
+
+// Returns the largest real root of p (to within about 2^-40 of its size), or -HUGE_VAL if p has no real roots
+// Assumes p is not zero
+double polyLargestRoot (const IntPoly *p);
+
+#endif
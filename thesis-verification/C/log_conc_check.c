@@ -6,7 +6,15 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
 #include "gmp-6.1.0/gmp.h" // Change accordingly
+#include "../../graph-utilities/bitgraph.h"
+#include "../../graph-utilities/g6io.h"
+#include "../../graph-utilities/graphgen.h"
+#include "stable_partitions.h"
+#include "results_cache.h"
+#include "results_file.h"
 
 /*
  * Verification used for section 6.1 (titled "Log-Concavity of $(P(G;k,\ell))_{\ell=0}^k$") of my master's thesis
@@ -15,26 +23,56 @@
  * (P(G;k,i))_{i=0}^k where P(G;x,y) is the two-variable chromatic polynomial of Dohmen, Poenitz, and Tittmann.
  * To compute these values, we run through all subsets of V(G) and record, for each i=0,...,k, the number
  * of stable sets of G cardinality i. We store these in the array 'results' and then compute the "b's" for
- * each k from 1 to MAX_COLOURS
+ * each k from 1 to MAX_COLOURS(n)
+ *
+ * The number of vertices n is read from each g6 string, and may be anything from 1 to MAX_N. The counting is
+ * done by kernels specialised for each n (see DEFINE_COUNT_KERNELS), so every n runs as fast as it would in a
+ * build for that n alone.
+ *
+ * With -d, the sequences from the deletion-contraction recurrence used for section 6.2 are checked instead (see
+ *  "Deletion-contraction" below).
  *
  * Requires the GNU Multiple Precision Arithmetic Library (GMP)
 */
 
-#define N 9 // number of vertices
-#define ADJ_MAT_SIZE ((N * (N - 1)) / 2)
-#define RESULTS_ROWS ((N / 2) + 1)
-#define RESULTS_COLS (N + 1)
-#define RESULTS_SIZE (RESULTS_ROWS * RESULTS_COLS)
-#define MAX_COLOURS (N + 2)
+#define MAX_N 16    // largest number of vertices we handle
+#define DEFAULT_N 9 // number of vertices checked when none is given
+#define MAX_COLOURS(n) ((n) + 2)
+#define NUM_BS(n) (MAX_COLOURS(n) * MAX_COLOURS(n)) // b_i(k) for 0 <= i, k < MAX_COLOURS(n)
+
+// Uncomment to count partitions by running through all Bell(n) set partitions instead of using
+//  dynamic programming over the subsets of V(G) (much slower, kept to cross-check the two methods)
+// #define COUNT_BY_ENUMERATION
+
+// Uncomment to count partitions both ways and report any graph for which the counts disagree
+// #define CROSS_CHECK_COUNTS
+
+// Uncomment to compute and compare the b's with GMP only (skipping the 128-bit fast path)
+// #define ALWAYS_USE_GMP
+
+// Uncomment to evaluate the b's for groups of EVAL_GROUP_SIZE graphs at once (as one matrix-matrix product)
+//  rather than graph by graph
+// #define EVAL_BS_BY_GROUP
+#ifdef EVAL_BS_BY_GROUP
+    #define EVAL_GROUP_SIZE 64
+#else
+    #define EVAL_GROUP_SIZE 1
+#endif
 
-// Uncomment to write the number of stable sets of each size for each graph
-// #define WRITE_RESULTS_TO_FILE
+// Largest number of results tables whose verdicts are kept in the cache (see -c and -C)
+#define CACHE_MAX_ENTRIES (1 << 22)
 
-// g6 format magic number (see documentation)
-#define G6_START_CHAR 63
+// With -i, most edges in which a graph may differ from the previous one for its counts to be worked out from
+//  the previous counts (each edge costs about a third of counting from scratch)
+#define MAX_INCREMENTAL_EDGES 2
 
-// File permissions when we create a file (all can read, user can write)
-#define FILE_PERMISSIONS S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH
+// Number of graphs handed to a worker thread at a time
+#define BATCH_SIZE 1024
+// Number of batches which may be in flight (read but not yet written) for each worker thread
+#define BATCHES_PER_THREAD 4
+
+// Always inline a function (so that constant arguments are propagated into its body)
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
 
 // Min macro that avoids double evaluation and checks if types agree (thanks stackoverflow)
 #define min(x, y) ({                \
@@ -44,386 +82,487 @@
     _min1 < _min2 ? _min1 : _min2; })
 
 
-// Our lists will be immutable and reference counted
-// We represent an (ordered) set of integers by a list and an (ordered) partition by a list of lists
-
-// List of integers
-typedef struct ILst {
-    int refcount;
-    int first;
-    struct ILst *rest;
-} ILst;
-
-// List of lists
-typedef struct LLst {
-    int refcount;
-    ILst *first;
-    struct LLst *rest;
-} LLst;
-
-// List of lists of lists
-typedef struct LLLst {
-    int refcount;
-    LLst *first;
-    struct LLLst *rest;
-} LLLst;
-
-/* Graph structure:
- * We store a graph as number of vertices and an adjacency matrix
- *  (for the purposes of this program this should always be N)
- * The adjacency matrix is stored as an array obtained by concatenating the columns of the upper triangular
- *  part of the adjacency matrix
- *  (i.e. for vertices v,w, adjMat[(u * (u - 1)) / 2 + v] is 1 if vw is an edge and 0 otherwise)
+/* Partition structure:
+ * We walk through the set partitions of {0,...,n-1} one at a time by their restricted growth strings
+ *  (rgs[v] is the index of the part containing v, so rgs[0] = 0 and rgs[v] <= 1 + max(rgs[0],...,rgs[v-1]))
+ * The parts themselves are kept as vertex masks (bit v of parts[p] is set if v is in part p)
+ * Nothing is allocated per partition, so memory use does not depend on the number of partitions
  */
-typedef struct Graph {
-    int nVerts;
-    char *adjMat;
-} Graph;
-
-
-
-/*  (Muliple functions)
-    "Constructors" for each lists
-    Appends elem to the list
-*/
-ILst *consILst (int elem, ILst *lst) {
-    ILst *newCell = (ILst*)malloc(sizeof(ILst));
-    newCell->refcount = 0;
-    newCell->first = elem;
-    newCell->rest = lst;
-    if (lst != NULL) {
-        newCell->rest->refcount += 1;
+typedef struct Partition {
+    int nParts;
+    int rgs[MAX_N];
+    int prefixMax[MAX_N]; // prefixMax[v] = max(rgs[0],...,rgs[v])
+    VertexSet parts[MAX_N];
+} Partition;
+
+// Fill in the parts of prtn (a partition of {0,...,n-1}) from its restricted growth string
+ALWAYS_INLINE void fillParts (Partition *prtn, const int n) {
+    prtn->nParts = prtn->prefixMax[n - 1] + 1;
+    for (int p = 0; p < prtn->nParts; p += 1) {
+        prtn->parts[p] = 0;
     }
-    return newCell;
-}
-
-LLst *consLLst (ILst *elem, LLst *lst) {
-    LLst *newCell = (LLst*)malloc(sizeof(LLst));
-    newCell->refcount = 0;
-    newCell->first = elem;
-    newCell->rest = lst;
-    if (lst != NULL) {
-        newCell->rest->refcount += 1;
+    for (int v = 0; v < n; v += 1) {
+        prtn->parts[prtn->rgs[v]] |= VERTEX_BIT(v);
     }
-    return newCell;
 }
 
-LLLst *consLLLst (LLst *elem, LLLst *lst) {
-    LLLst *newCell = (LLLst*)malloc(sizeof(LLLst));
-    newCell->refcount = 0;
-    newCell->first = elem;
-    newCell->rest = lst;
-    if (lst != NULL) {
-        newCell->rest->refcount += 1;
+
+// Set prtn to the first set partition of {0,...,n-1} (the partition with a single part)
+ALWAYS_INLINE void firstPartition (Partition *prtn, const int n) {
+    for (int v = 0; v < n; v += 1) {
+        prtn->rgs[v] = 0;
+        prtn->prefixMax[v] = 0;
     }
-    return newCell;
+    fillParts(prtn, n);
 }
 
 
-/*  (Muliple functions)
-    Print lists (for debugging)
-*/
-void printILst (ILst *lst) {
-    printf("(");
-    if (lst != NULL) {
-        printf("%d", lst->first);
-        lst = lst->rest;
-        while (lst != NULL) {
-            printf(" %d", lst->first);
-            lst = lst->rest;
-        }
+// Advance prtn to the next set partition of {0,...,n-1} (in lexicographic order of restricted growth strings)
+// Returns 0 if prtn was the last partition, 1 otherwise
+ALWAYS_INLINE int nextPartition (Partition *prtn, const int n) {
+    // Find the last position which can be incremented
+    int v = n - 1;
+    while (v > 0 && prtn->rgs[v] > prtn->prefixMax[v - 1]) {
+        v -= 1;
     }
-    printf(")");
-}
-
-void printLLst (LLst *lst) {
-    printf("(");
-    if (lst != NULL) {
-        printILst(lst->first);
-        lst = lst->rest;
-        while (lst != NULL) {
-            printf(" ");
-            printILst(lst->first);
-            lst = lst->rest;
-        }
+    if (v == 0) {
+        return 0;
     }
-    printf(")");
-}
 
-void printLLLst (LLLst *lst) {
-    printf("(");
-    if (lst != NULL) {
-        printLLst(lst->first);
-        lst = lst->rest;
-        while (lst != NULL) {
-            printf(" ");
-            printLLst(lst->first);
-            lst = lst->rest;
-        }
+    prtn->rgs[v] += 1;
+    prtn->prefixMax[v] = prtn->prefixMax[v - 1] > prtn->rgs[v] ? prtn->prefixMax[v - 1] : prtn->rgs[v];
+    for (v += 1; v < n; v += 1) {
+        prtn->rgs[v] = 0;
+        prtn->prefixMax[v] = prtn->prefixMax[v - 1];
     }
-    printf(")");
+    fillParts(prtn, n);
+    return 1;
 }
 
 
-/*  (Muliple functions)
-    Appends elem to each element of the list
-*/
-LLst *consAllILst (int elem, LLst *lst) {
-    LLst *pos = lst;
-    while (pos != NULL) {
-        pos->first = consILst(elem, pos->first);
-        pos = pos->rest;
+// Returns the number of parts of prtn which are stable in g
+ALWAYS_INLINE int numStableSets (Partition *prtn, Graph *g) {
+    int n = 0;
+    for (int p = 0; p < prtn->nParts; p += 1) {
+        n += isStableSet(g, prtn->parts[p]);
     }
-    return lst;
+    return n;
 }
 
-LLLst *consAllLLst (ILst *elem, LLLst *lst) {
-    LLLst *pos = lst;
-    while (pos != NULL) {
-        pos->first = consLLst(elem, pos->first);
-        elem->refcount += 1;
-        pos = pos->rest;
-    }
-    return lst;
+
+// Sets the entry of 'results' at position (n + 1) * t + s to be the number of partitions of V(g) with exactly
+// s stable parts and t non-stable parts (by running through all partitions of V(g))
+// Assumes g has n vertices, and 'results' is initialised to zero and has RESULTS_SIZE(n) entries
+ALWAYS_INLINE void countPartitionsEnumKernel (Graph *g, unsigned int *results, const int n) {
+    Partition prtn;
+    firstPartition(&prtn, n);
+    do {
+        int stbl = numStableSets(&prtn, g);
+        results[((n + 1) * (prtn.nParts - stbl)) + stbl] += 1;
+    } while (nextPartition(&prtn, n) != 0);
 }
 
 
-/*  (Muliple functions)
-    Functions to free lists
-*/
-void freeILst (ILst *lst) {
-    while (lst != NULL) {
-        lst->refcount -= 1;
-        if (lst->refcount > 0) {
-            break;
+/* Counting by subset dynamic programming:
+ * Instead of running through all Bell(n) partitions, we work with the 2^n subsets of V(g).
+ * Let a_m(X) be the number of partitions of X into m stable parts and let alpha[m][r] be the sum of a_m(X)
+ *  over all X with |X| = r (see stable_partitions.h). A partition with s stable parts and t non-stable parts
+ *  is a partition of some X into s stable parts together with a partition of V(g) \ X into t non-stable parts.
+ *  Counting the latter by inclusion-exclusion on the parts which happen to be stable (and merging the two
+ *  families of stable parts) gives
+ *
+ *      results[t][s] = sum_{j=0}^{t} (-1)^j C(s+j,s) sum_{r=0}^{n} alpha[s+j][r] S(n-r,t-j)
+ *
+ *  where S(n,k) are the Stirling numbers of the second kind. The a_m(X) are computed by removing the part
+ *  containing the least element of X, which costs about 3^n steps in total.
+ * All arithmetic is done with unsigned (wrapping) integers, which is exact since the final counts fit in an
+ *  unsigned int (no entry can exceed the largest Stirling number S(MAX_N,k), which is less than 2^32).
+ */
+_Static_assert(MAX_N <= STABLE_MAX_N, "the subset tables are too small");
+
+// Tables which do not depend on the graph (filled by initCountingTables)
+unsigned long long binomials[MAX_N + 1][MAX_N + 1];
+unsigned long long stirling2[MAX_N + 1][MAX_N + 1];
+
+// Fill in the binomial coefficients and Stirling numbers of the second kind
+void initCountingTables (void) {
+    for (int n = 0; n <= MAX_N; n += 1) {
+        for (int k = 0; k <= MAX_N; k += 1) {
+            if (k == 0) {
+                binomials[n][k] = 1;
+                stirling2[n][k] = (n == 0);
+            } else if (n == 0) {
+                binomials[n][k] = 0;
+                stirling2[n][k] = 0;
+            } else {
+                binomials[n][k] = binomials[n - 1][k - 1] + binomials[n - 1][k];
+                stirling2[n][k] = stirling2[n - 1][k - 1] + k * stirling2[n - 1][k];
+            }
         }
-        ILst *rest = lst->rest;
-        free(lst);
-        lst = rest;
     }
 }
 
-void freeLLst (LLst *lst) {
-    while (lst != NULL) {
-        lst->refcount -= 1;
-        if (lst->refcount > 0) {
-            break;
-        }
-        LLst *rest = lst->rest;
-        freeILst(lst->first);
-        free(lst);
-        lst = rest;
-    }
-}
 
-void freeLLLst (LLLst *lst) {
-    while (lst != NULL) {
-        lst->refcount -= 1;
-        if (lst->refcount > 0) {
-            break;
+// Sets the entries of 'results' for a graph on n vertices from the sums alpha[m][r] of sumStablePartitions
+// If 'rooted' is 1, alpha must be the sums over the X containing vertex 0 instead, and only the partitions in
+//  which the part containing vertex 0 is stable are counted (when the part of vertex 0 is one of the s + j
+//  stable parts of the inclusion-exclusion, which is the case for C(s+j-1,s-1) of the C(s+j,s) ways to choose s
+//  of them)
+ALWAYS_INLINE void combineStablePartitions (AlphaTable alpha, unsigned int *results, const int n, const int rooted) {
+    for (int t = 0; t < RESULTS_ROWS(n); t += 1) {
+        for (int s = 0; s + t <= n; s += 1) {
+            unsigned long long total = 0;
+            for (int j = 0; j <= t && (s > 0 || !rooted); j += 1) {
+                unsigned long long sum = 0;
+                for (int r = 0; r <= n; r += 1) {
+                    sum += alpha[s + j][r] * stirling2[n - r][t - j];
+                }
+                sum *= rooted ? binomials[s + j - 1][s - 1] : binomials[s + j][s];
+                total = (j % 2 == 0) ? total + sum : total - sum;
+            }
+            results[((n + 1) * t) + s] = (unsigned int) total;
         }
-        LLLst *rest = lst->rest;
-        freeLLst(lst->first);
-        free(lst);
-        lst = rest;
     }
 }
 
 
-/*  (Muliple functions)
-    Returns the length of the list
-*/
-int lengthLLst (LLst *lst) {
-    int len = 0;
-    while (lst != NULL) {
-        len += 1;
-        lst = lst->rest;
-    }
-    return len;
+// Sets the entries of 'results' as in countPartitionsEnumKernel, using the subset dynamic programming described above
+// Assumes g has n vertices, 'tables' has room for n vertices, and 'results' is initialised to zero and
+//  has RESULTS_SIZE(n) entries
+ALWAYS_INLINE void countPartitionsDPKernel (Graph *g, unsigned int *results, SubsetTables *tables, const int n) {
+    AlphaTable alpha;
+    sumStablePartitions(g, tables, alpha, NULL, n, 0);
+    combineStablePartitions(alpha, results, n, 0);
 }
 
 
-int lengthLLLst (LLLst *lst) {
-    int len = 0;
-    while (lst != NULL) {
-        len += 1;
-        lst = lst->rest;
+// With one pass of the subset dynamic programming over g (on n vertices), count the partitions of V(g) into
+//  'results' (as countPartitionsDPKernel), those of them whose part containing vertex 0 is stable into 'rootStable',
+//  and the partitions of V(g) - 0 into 'minusRoot' (laid out like results for n - 1 vertices)
+// The sets X not containing vertex 0 are exactly the subsets of V(g) - 0, so their sums are the alpha's of g - 0
+// Assumes 'tables' has room for n vertices and the three tables are initialised to zero
+ALWAYS_INLINE void countRootedDPKernel (Graph *g, unsigned int *results, unsigned int *rootStable, unsigned int *minusRoot,
+                                        SubsetTables *tables, const int n) {
+    AlphaTable alpha;
+    AlphaTable alphaRoot;
+    sumStablePartitions(g, tables, alpha, alphaRoot, n, 1);
+    combineStablePartitions(alpha, results, n, 0);
+    combineStablePartitions(alphaRoot, rootStable, n, 1);
+    for (int m = 0; m <= n; m += 1) {
+        for (int r = 0; r <= n; r += 1) {
+            alpha[m][r] -= alphaRoot[m][r];
+        }
     }
-    return len;
+    combineStablePartitions(alpha, minusRoot, n - 1, 0);
 }
 
 
-// Returns the result of appending lst2 to the end of lst1 (both LLLsts)
-LLLst *appendLLLst (LLLst *lst1, LLLst *lst2) {
-    if (lst1 == NULL) {
-        return lst2;
-    } else if (lst2 == NULL) {
-        return lst1;
+// Specialise the counting kernels for each number of vertices, so that n is a compile-time constant in each
+//  copy (and the compiler can unroll the loops whose trip counts only depend on n)
+typedef void (*EnumKernel) (Graph *g, unsigned int *results);
+typedef void (*DPKernel) (Graph *g, unsigned int *results, SubsetTables *tables);
+typedef void (*RootedDPKernel) (Graph *g, unsigned int *results, unsigned int *rootStable, unsigned int *minusRoot,
+                                SubsetTables *tables);
+
+#define DEFINE_COUNT_KERNELS(n)                                                                                       \
+    void countPartitionsEnum##n (Graph *g, unsigned int *results) {                                                   \
+        countPartitionsEnumKernel(g, results, n);                                                                     \
+    }                                                                                                                 \
+    void countPartitionsDP##n (Graph *g, unsigned int *results, SubsetTables *tables) {                               \
+        countPartitionsDPKernel(g, results, tables, n);                                                               \
+    }                                                                                                                 \
+    void countRootedDP##n (Graph *g, unsigned int *results, unsigned int *rootStable, unsigned int *minusRoot,        \
+                           SubsetTables *tables) {                                                                    \
+        countRootedDPKernel(g, results, rootStable, minusRoot, tables, n);                                            \
     }
 
-    LLLst *newLst = consLLLst(lst1->first, NULL);
-    LLLst *pos = newLst;
-    lst1 = lst1->rest;
-    while (lst1 != NULL) {
-        pos->rest = consLLLst(lst1->first, NULL);
-        pos = pos->rest;
-        lst1 = lst1->rest;
-    }
-    pos->rest = lst2;
-    return newLst;
+DEFINE_COUNT_KERNELS(1)
+DEFINE_COUNT_KERNELS(2)
+DEFINE_COUNT_KERNELS(3)
+DEFINE_COUNT_KERNELS(4)
+DEFINE_COUNT_KERNELS(5)
+DEFINE_COUNT_KERNELS(6)
+DEFINE_COUNT_KERNELS(7)
+DEFINE_COUNT_KERNELS(8)
+DEFINE_COUNT_KERNELS(9)
+DEFINE_COUNT_KERNELS(10)
+DEFINE_COUNT_KERNELS(11)
+DEFINE_COUNT_KERNELS(12)
+DEFINE_COUNT_KERNELS(13)
+DEFINE_COUNT_KERNELS(14)
+DEFINE_COUNT_KERNELS(15)
+DEFINE_COUNT_KERNELS(16)
+
+const EnumKernel enumKernels[MAX_N + 1] = {
+    NULL, countPartitionsEnum1, countPartitionsEnum2, countPartitionsEnum3, countPartitionsEnum4,
+    countPartitionsEnum5, countPartitionsEnum6, countPartitionsEnum7, countPartitionsEnum8,
+    countPartitionsEnum9, countPartitionsEnum10, countPartitionsEnum11, countPartitionsEnum12,
+    countPartitionsEnum13, countPartitionsEnum14, countPartitionsEnum15, countPartitionsEnum16
+};
+
+const DPKernel dpKernels[MAX_N + 1] = {
+    NULL, countPartitionsDP1, countPartitionsDP2, countPartitionsDP3, countPartitionsDP4,
+    countPartitionsDP5, countPartitionsDP6, countPartitionsDP7, countPartitionsDP8,
+    countPartitionsDP9, countPartitionsDP10, countPartitionsDP11, countPartitionsDP12,
+    countPartitionsDP13, countPartitionsDP14, countPartitionsDP15, countPartitionsDP16
+};
+
+const RootedDPKernel rootedDPKernels[MAX_N + 1] = {
+    NULL, countRootedDP1, countRootedDP2, countRootedDP3, countRootedDP4,
+    countRootedDP5, countRootedDP6, countRootedDP7, countRootedDP8,
+    countRootedDP9, countRootedDP10, countRootedDP11, countRootedDP12,
+    countRootedDP13, countRootedDP14, countRootedDP15, countRootedDP16
+};
+
+
+// Count partitions of V(g) by stable and non-stable parts by running through all of them
+// (see countPartitionsEnumKernel, assumes 1 <= g->nVerts <= MAX_N)
+void countPartitionsEnum (Graph *g, unsigned int *results) {
+    enumKernels[g->nVerts](g, results);
 }
 
 
-// Add elem tor prtn in all possible ways (i.e. add it to each part and as its own part)
-LLLst *addToPrtn (int elem, LLst *prtn) {
-    if (prtn == NULL) {
-        return consLLLst(consLLst(consILst(elem, NULL), NULL), NULL);
-    } else {
-        return consLLLst(consLLst(consILst(elem, prtn->first), prtn->rest), consAllLLst(prtn->first, addToPrtn(elem, prtn->rest)));
-    }
+// Count partitions of V(g) by stable and non-stable parts by subset dynamic programming
+// (see countPartitionsDPKernel, assumes 1 <= g->nVerts <= MAX_N)
+void countPartitionsDP (Graph *g, unsigned int *results, SubsetTables *tables) {
+    ensureSubsetTables(tables, g->nVerts);
+    dpKernels[g->nVerts](g, results, tables);
 }
 
 
-// Add elem to each partition in prtns (a list of partitions) in all possible ways
-LLLst *addToAllPrtns (int elem, LLLst *prtns) {
-    LLLst *result = NULL;
-    while (prtns != NULL) {
-        result = appendLLLst(addToPrtn(elem, prtns->first), result);
-        prtns = prtns->rest;
-    }
-    return result;
+/* Adding and contracting an edge:
+ * Let u and v be non-adjacent vertices of g. A partition of V(g) in which u and v are in different parts has the
+ *  same stable parts in g + uv as in g. One in which they share a part B is also the same in g + uv, except that
+ *  B is no longer stable if it was stable in g (so it moves from row t, column s of the results to row t + 1,
+ *  column s - 1). The partitions of V(g) in which u and v share a stable part are exactly the partitions of g/uv
+ *  (u and v merged into one vertex w, adjacent to the neighbours of both) in which the part containing w is stable.
+ *  So if D[t][s] counts those,
+ *
+ *      results(g + uv)[t][s] = results(g)[t][s] - D[t][s] + D[t-1][s+1]
+ *
+ *  and D comes from a pass of the dynamic programming over g/uv, which has one vertex less than g (so it costs
+ *  about a third of counting g + uv from scratch). The same pass counts the partitions of g/uv itself and of
+ *  g - u - v = g/uv - w, which are the other two graphs of the deletion-contraction recurrence (see -d).
+ */
+
+// Count the partitions of g/uv (see graphContractPair) into 'contracted', those of them in which the part containing
+//  the merged vertex is stable into 'merged' (both laid out like results for g->nVerts - 1 vertices), and the
+//  partitions of g - u - v into 'rest' (laid out like results for g->nVerts - 2 vertices)
+// Assumes 2 <= g->nVerts <= MAX_N and u != v
+void countContraction (const Graph *g, int u, int v, unsigned int *contracted, unsigned int *merged, unsigned int *rest,
+                       SubsetTables *tables) {
+    Graph h;
+    graphContractPair(g, u, v, &h);
+    int n = h.nVerts;
+    memset(contracted, 0, sizeof(unsigned int) * RESULTS_SIZE(n));
+    memset(merged, 0, sizeof(unsigned int) * RESULTS_SIZE(n));
+    memset(rest, 0, sizeof(unsigned int) * RESULTS_SIZE(n - 1));
+    ensureSubsetTables(tables, n);
+    rootedDPKernels[n](&h, contracted, merged, rest, tables);
 }
 
 
-// Produces a list of all set partitions of the set {0,...,n-1}
-LLLst *partitionsList (int n) {
-    if (n == 0) {
-        return consLLLst(NULL, NULL);
-    } else {
-        return addToAllPrtns(n-1, partitionsList(n-1));
+// Change the results for a graph on n vertices into those for the graph with the edge uv added (if 'adding' is 1)
+//  or deleted (if it is 0), where 'merged' is the table of the same name from countContraction
+void moveMergedPartitions (unsigned int *results, int n, const unsigned int *merged, int adding) {
+    for (int t = 0; t < RESULTS_ROWS(n - 1); t += 1) {
+        for (int s = 1; s + t <= n - 1; s += 1) {
+            unsigned int d = merged[n * t + s];
+            // A part of 2 or more vertices (containing u and v) becomes non-stable, so d = 0 whenever row t + 1
+            //  would be past the end of the table
+            if (d == 0) {
+                continue;
+            }
+            if (adding) {
+                results[(n + 1) * t + s] -= d;
+                results[(n + 1) * (t + 1) + s - 1] += d;
+            } else {
+                results[(n + 1) * t + s] += d;
+                results[(n + 1) * (t + 1) + s - 1] -= d;
+            }
+        }
     }
 }
 
 
-// Returns 1 if the set is stable in the graph g, 0 otherwise
-int isStable(ILst *set, Graph *g) {
-    // For each vertex u in the set, check if u is adjacent to any remaining vertex in the set
-    while(set != NULL) {
-        int u = set->first;
-        set = set->rest;
-        int colStartIndx = (u * (u - 1)) / 2;
-        for (ILst *pos = set; pos != NULL; pos = pos->rest) {
-            if (g->adjMat[colStartIndx + pos->first]) {
-                return 0;
-            }
+// Growable text buffer (used to collect the output for a batch of graphs)
+typedef struct OutBuf {
+    char *text;
+    size_t len;
+    size_t cap;
+} OutBuf;
+
+
+// Append to 'buf' as printf would print
+// Assumes buf->text has been allocated with buf->cap > 0 characters
+void bufPrintf (OutBuf *buf, const char *format, ...) {
+    va_list args;
+    while (1) {
+        size_t avail = buf->cap - buf->len;
+        va_start(args, format);
+        int written = vsnprintf(&buf->text[buf->len], avail, format, args);
+        va_end(args);
+        if (written < 0) {
+            return;
+        } else if ((size_t) written < avail) {
+            buf->len += written;
+            return;
         }
+        buf->cap = 2 * buf->cap + written;
+        buf->text = (char*)realloc(buf->text, sizeof(char) * buf->cap);
     }
-    return 1;
 }
 
 
-// Returns the number of sets in the given list which are stable in g
-int numStableSets (LLst *sets, Graph *g) {
-    int n = 0;
-    while (sets != NULL) {
-        n += isStable(sets->first, g);
-        sets = sets->rest;
+// Compute n! and return as z
+void fact (mpz_t z, unsigned int n) {
+    mpz_set_ui(z,1);
+    while (n > 0) {
+        mpz_mul_ui(z, z, n);
+        n -= 1;
     }
-    return n;
 }
 
 
-// Sets the i-th entry of 'results' to be the number of partitions (provided as prtns) of V(g)
-// with exactly i stable parts
-// Assumes 'results' is initialised to zero and has RESULTS_SIZE entries
-void countPartitions (LLLst *prtns, Graph *g, int *results) {
-    while (prtns != NULL) {
-        int stbl = numStableSets(prtns->first, g);
-        results[((N + 1) * (lengthLLst(prtns->first) - stbl)) + stbl] += 1;
-        prtns = prtns->rest;
+// Compute the falling factorial (n)_k and return as z
+void fallingFact (mpz_t z, unsigned int n, unsigned int k) {
+    if (k > n) {
+        mpz_set_ui(z, 0);
+    } else {
+        mpz_set_ui(z,1);
+        for (unsigned int i = n; i > n - k; i -= 1) {
+            mpz_mul_ui (z, z, i);
+        }
     }
 }
 
-// Read a graph (in g6 format) from the file descriptor 'in'
-// Assumes the graph being read has no more than 62 vertices and that the adjacency matrix has ADJ_MAT_SIZE entries
-// For more details see the documentation for g6 format (from B. McKay and A. Piperino's nauty & traces)
-int readGraph (int in, Graph *g) {
-    int c = 0;
-    if (read(in, &c, sizeof(char)) == 0) {
-        return 0; // Reached EOF
-    }
-    g->nVerts = c - G6_START_CHAR;
 
-    int pos = 0;
-    while (read(in, &c, sizeof(char)) != 0) {
-        if (c == '\n') {
-            break;
-        }
+/* Falling factorials:
+ * The b's only need (k)_j for k, j < MAX_COLOURS(MAX_N), so we tabulate them once (each row from the previous
+ *  entry, (k)_j = (k)_{j-1} * (k - j + 1)) and share the table between all graphs and threads. They are
+ *  kept both as native integers (at most 17!, so they fit in 64 bits) and as GMP integers.
+ */
+#define FF_SIZE MAX_COLOURS(MAX_N)
+unsigned long long fallingFacts[FF_SIZE][FF_SIZE];
+mpz_t fallingFactsZ[FF_SIZE][FF_SIZE];
 
-        c = c - G6_START_CHAR;
-        for (int i = 5; i >= 0 && pos < ADJ_MAT_SIZE; i -= 1) {
-            g->adjMat[pos++] = (c >> i) & 1;
+
+// Fill in the tables of falling factorials
+void initFallingFacts (void) {
+    for (int k = 0; k < FF_SIZE; k += 1) {
+        fallingFacts[k][0] = 1;
+        for (int j = 1; j < FF_SIZE; j += 1) {
+            fallingFacts[k][j] = (j > k) ? 0 : fallingFacts[k][j - 1] * (k - j + 1);
+        }
+        for (int j = 0; j < FF_SIZE; j += 1) {
+            mpz_init(fallingFactsZ[k][j]);
+            mpz_set_ui(fallingFactsZ[k][j], 0);
+            mpz_add_ui(fallingFactsZ[k][j], fallingFactsZ[k][j], fallingFacts[k][j] >> 32);
+            mpz_mul_2exp(fallingFactsZ[k][j], fallingFactsZ[k][j], 32);
+            mpz_add_ui(fallingFactsZ[k][j], fallingFactsZ[k][j], fallingFacts[k][j] & 0xFFFFFFFF);
         }
     }
-    return 1;
 }
 
 
-// Print contents of g (for debugging)
-void printGraph (Graph *g) {
-    printf("Graph on %d vertices:\n", g->nVerts);
+/* Evaluation plans:
+ * For a graph on n vertices, b_i(k) is the sum of (k)_{ns+s} * results[ns][s] over ns <= k - i and ns + s <= k,
+ *  so the whole grid of b's is a fixed linear map of the results. Writing c_k[ns] for the sum over s of
+ *  (k)_{ns+s} * results[ns][s], b_i(k) = c_k[0] + ... + c_k[min(k - i, RESULTS_ROWS(n) - 1)] (and 0 when i > k).
+ *  The plan for n holds the coefficients (k)_{ns+s} for every k, laid out like the results, so that every b
+ *  comes out of one pass over the plan followed by prefix sums (instead of one pass over the results per b).
+ * The b's are computed with unsigned __int128: each one is a sum of at most RESULTS_SIZE(n) products of an
+ *  unsigned int and a falling factorial below 2^49, so this can't overflow for n <= 16. Comparing b_y^2 with
+ *  b_x * b_z only fits in 128 bits when the b's are below 2^64 (always the case for n <= 11); for the k where
+ *  this fails we redo the computation with GMP.
+ */
+typedef unsigned __int128 uint128;
+_Static_assert(MAX_N <= 16, "the b's may overflow 128 bits");
 
-    for (int i = 0; i < g->nVerts-1; i += 1) {
-        for (int j = 1; j < g->nVerts; j += 1) {
-            if (j <= i) {
-                printf("  ");
-            } else {
-                printf("%d ", g->adjMat[(j * (j - 1)) / 2 + i]);
+typedef struct EvalPlan {
+    unsigned long long *coefs; // coefs[k * RESULTS_SIZE(n) + ns * RESULTS_COLS(n) + s] = (k)_{ns+s} (or 0 if ns + s > k)
+} EvalPlan;
+
+EvalPlan evalPlans[MAX_N + 1];
+
+
+// Build the evaluation plans for every n (after initFallingFacts)
+void initEvalPlans (void) {
+    for (int n = 1; n <= MAX_N; n += 1) {
+        unsigned long long *coefs = (unsigned long long*)malloc(sizeof(unsigned long long) * MAX_COLOURS(n) * RESULTS_SIZE(n));
+        for (int k = 0; k < MAX_COLOURS(n); k += 1) {
+            for (int ns = 0; ns < RESULTS_ROWS(n); ns += 1) {
+                for (int s = 0; s < RESULTS_COLS(n); s += 1) {
+                    coefs[k * RESULTS_SIZE(n) + ns * RESULTS_COLS(n) + s] = (ns + s <= k) ? fallingFacts[k][ns + s] : 0;
+                }
             }
         }
-        printf("\n");
+        evalPlans[n].coefs = coefs;
     }
 }
 
 
-// Write the results to 'out'
-// Assumes results has RESULTS_SIZE entries
-void writeGraphResults (int out, int *results) {
-    write(out, results, sizeof(int) * RESULTS_SIZE);
-}
-
+// Evaluate the b's of nGraphs graphs on n vertices (at most EVAL_GROUP_SIZE) together
+// The results of graph j start at results[j * RESULTS_SIZE(MAX_N)], and b_i(k) for graph j is left in
+//  b[j * NUM_BS(MAX_N) + k * MAX_COLOURS(n) + i]
+// Each coefficient is loaded once and applied to every graph, so this is a matrix-matrix product
+void evalBs (int n, int nGraphs, const unsigned int *results, uint128 *b) {
+    const unsigned long long *coefs = evalPlans[n].coefs;
+    uint128 sums[EVAL_GROUP_SIZE][RESULTS_ROWS(MAX_N)];
+
+    for (int k = 0; k < MAX_COLOURS(n); k += 1) {
+        // Rows with ns > k have all coefficients 0
+        int rows = min(RESULTS_ROWS(n), k + 1);
+        for (int ns = 0; ns < rows; ns += 1) {
+            for (int j = 0; j < nGraphs; j += 1) {
+                sums[j][ns] = 0;
+            }
+            for (int s = 0; s < RESULTS_COLS(n) && ns + s <= k; s += 1) {
+                unsigned long long coef = coefs[ns * RESULTS_COLS(n) + s];
+                for (int j = 0; j < nGraphs; j += 1) {
+                    sums[j][ns] += (uint128) coef * results[j * RESULTS_SIZE(MAX_N) + ns * RESULTS_COLS(n) + s];
+                }
+            }
+        }
 
-// Compute n! and return as z
-void fact (mpz_t z, unsigned int n) {
-    mpz_set_ui(z,1);
-    while (n > 0) {
-        mpz_mul_ui(z, z, n);
-        n -= 1;
+        for (int j = 0; j < nGraphs; j += 1) {
+            for (int ns = 1; ns < rows; ns += 1) {
+                sums[j][ns] += sums[j][ns - 1];
+            }
+            uint128 *bk = &b[j * NUM_BS(MAX_N) + k * MAX_COLOURS(n)];
+            for (int i = 0; i < MAX_COLOURS(n); i += 1) {
+                bk[i] = (i > k) ? 0 : sums[j][min(k - i, rows - 1)];
+            }
+        }
+        coefs += RESULTS_SIZE(n);
     }
 }
 
 
-// Compute the falling factorial (n)_k and return as z
-void fallingFact (mpz_t z, unsigned int n, unsigned int k) {
-    if (k > n) {
-        mpz_set_ui(z, 0);
-    } else {
-        mpz_set_ui(z,1);
-        for (unsigned int i = n; i > n - k; i -= 1) {
-            mpz_mul_ui (z, z, i);
+// Same as checkLogConc, but with 128-bit integers
+// Returns 1 on success (with the set of i's stored in *fails), or 0 if the products don't fit in 128 bits
+// Assumes b has MAX_COLOURS(n) entries
+int checkLogConcFast (int k, int n, const uint128 *b, unsigned int *fails) {
+    for (int i = 0; i < MAX_COLOURS(n); i += 1) {
+        if ((b[i] >> 64) != 0) {
+            return 0;
         }
     }
+    *fails = 0;
+    for (int x = 0, y = 1, z = 2; z < MAX_COLOURS(n); x += 1, y += 1, z += 1) {
+        if (b[y] * b[y] < b[x] * b[z]) {
+            *fails |= 1u << y;
+        }
+    }
+    return 1;
 }
 
 
 // For each i, returns the number of colour assignments with the first i colours stable
 // as the i-th entry of b
-// Assumes b has MAX_COLOURS entries
-void computeBs (int k, int *results, mpz_t *b) {
-    mpz_t z1, z2;
-    mpz_init(z1);
-    mpz_init(z2);
-    for (unsigned int i = 0; i < MAX_COLOURS; i += 1) {
+// Assumes b has MAX_COLOURS(n) entries, where n is the number of vertices of the graph
+void computeBs (int k, int n, unsigned int *results, mpz_t *b) {
+    for (unsigned int i = 0; i < MAX_COLOURS(n); i += 1) {
         mpz_set_ui(b[i], 0);
         if (i > k) {
             continue;
@@ -432,11 +571,10 @@ void computeBs (int k, int *results, mpz_t *b) {
         int resPos = 0;
         // Note: If the order of the loops is changed for some reason, don't keep the min
         //  in the exit condition for the ns for loop
-        for (unsigned int ns = 0; ns < min((unsigned int) RESULTS_ROWS, k - i + 1); ns += 1) {
-            for (unsigned int s = 0; s < RESULTS_COLS; s += 1) {
+        for (unsigned int ns = 0; ns < min((unsigned int) RESULTS_ROWS(n), k - i + 1); ns += 1) {
+            for (unsigned int s = 0; s < RESULTS_COLS(n); s += 1) {
                 if (ns + s <= k) {
-                    fallingFact(z1, k, ns + s);
-                    mpz_addmul_ui(b[i], z1, (unsigned int) results[resPos]);
+                    mpz_addmul_ui(b[i], fallingFactsZ[k][ns + s], results[resPos]);
                 }
                 resPos += 1;
             }
@@ -447,29 +585,44 @@ void computeBs (int k, int *results, mpz_t *b) {
 
 
 // Check if b's are log-concave
-// In case they are not, print the line (g6 string) as well as the particular values of k and i
-// Assumes b has MAX_COLOURS entries
-void checkLogConc(int line, int k, mpz_t *b) {
+// Returns the set of i's (as a bit mask) for which b_i^2 < b_{i-1} * b_{i+1}, so 0 if the b's are log-concave
+// Assumes b has MAX_COLOURS(n) entries
+unsigned int checkLogConc(int k, int n, mpz_t *b) {
+    unsigned int fails = 0;
     mpz_t bb, ac;
     mpz_init(bb);
     mpz_init(ac);
-    for (int x = 0, y = 1, z = 2; z < MAX_COLOURS; x += 1, y += 1, z += 1) {
+    for (int x = 0, y = 1, z = 2; z < MAX_COLOURS(n); x += 1, y += 1, z += 1) {
         mpz_mul(ac, b[x], b[z]);
         mpz_mul(bb, b[y], b[y]);
         if (mpz_cmp(bb,ac) < 0) {
-            printf("line = %d -- k = %d -- i = %d\n", line, k, y);
+            fails |= 1u << y;
+        }
+    }
+    mpz_clear(bb);
+    mpz_clear(ac);
+    return fails;
+}
+
+
+// Print (to 'out') the line (g6 string) as well as the particular values of k and i for which the b's of
+//  a graph on n vertices are not log-concave, where fails[k] is the set of i's for k (see checkLogConc)
+void printFailures (int line, int n, const unsigned int *fails, OutBuf *out) {
+    for (int k = 0; k < MAX_COLOURS(n); k += 1) {
+        for (unsigned int rest = fails[k]; rest != 0; rest &= rest - 1) {
+            bufPrintf(out, "line = %d -- k = %d -- i = %d\n", line, k, __builtin_ctz(rest));
         }
     }
 }
 
 
 // Print the b's (for debugging)
-// Assumes b has MAX_COLOURS entries
-void printBs(mpz_t *b) {
+// Assumes b has MAX_COLOURS(n) entries
+void printBs(mpz_t *b, int n) {
     printf("[");
-    for (int i = 0; i < MAX_COLOURS; i += 1) {
+    for (int i = 0; i < MAX_COLOURS(n); i += 1) {
         gmp_printf("%Zd", b[i]);
-        if (i < MAX_COLOURS - 1) {
+        if (i < MAX_COLOURS(n) - 1) {
             printf(", ");
         }
     }
@@ -477,93 +630,958 @@ void printBs(mpz_t *b) {
 }
 
 
-// Open the file of g6 strings
-// Assumes graphs with n vertices are in the file 'graphs_data/connected/graphs_n.g6'
-int openGraphDataFile(int n) {
-    // length("graph_data/graphs_") = 18
-    // length(".g6") = 3
-    // We won't be worried about numbers of vertices larger than 99 so our filepath
-    //  should be a string of length at most 24 = 18 + 2 + 3 + 1 (null terminator)
-    char *filepath = (char*)malloc(sizeof(char) * 24);
-    filepath[24-1] = filepath[24] = '\0';
+// Open a file of g6 strings (printing an error if it fails)
+G6File *openGraphDataFile (const char *filepath) {
+    G6File *f = g6Open(filepath);
+    if (f == NULL) {
+        printf("Failed to open intput file.\n");
+        printf("%s\n", strerror(errno));
+        printf("Filepath: %s\n", filepath);
+    }
+    return f;
+}
+
+
+// Verdicts for the results tables seen so far (shared by all threads), or NULL if we're not caching them
+ResultsCache *resultsCache = NULL;
+
+// 1 if graphs are counted from the previous graph of the thread when they differ in few edges (see -i)
+int incremental = 0;
+
+// 1 if we check the sequences of the deletion-contraction recurrence instead (see -d)
+int deletionContraction = 0;
+
+
+/* Deletion-contraction (section 6.2 of my master's thesis, see -d):
+ * For an edge e = uv of G, the deletion-contraction recurrence for P(G;x,y) has the terms P(G-e;x,y), P(G/e;x,y)
+ *  and (x-y)P(G-u-v;x,y). Writing Sdel, Scon and Sext for the sequences of these at x = k and y = 0,...,k, we check
+ *  that Sdel - Scon, Sext - Scon and Sdel + Sext are log-concave for every edge and k = 1,...,n, and report the
+ *  first sequence which isn't (as other_log_conc_seqs.sage does). Sdel - Scon and Sext - Scon may have negative
+ *  terms, so these checks are done with signed integers.
+ * The results for G - e follow from those for G (see "Adding and contracting an edge"), and the pass over G/e
+ *  which that takes also counts G/e and G - u - v, so each edge costs one pass over n - 1 vertices.
+ */
+#define NUM_DC_TERMS 3
+#define DC_DEL 0
+#define DC_CON 1
+#define DC_EXT 2
+#define NUM_DC_SEQS 3
+
+// Sequence q is the sum over the terms p of dcSeqCoefs[q][p] times the sequence of term p
+const int dcSeqCoefs[NUM_DC_SEQS][NUM_DC_TERMS] = {{1, -1, 0}, {0, -1, 1}, {1, 0, 1}};
+const char *dcSeqNames[NUM_DC_SEQS] = {"Sdel - Scon", "-Scon + Sext", "Sdel + Sext"};
+
+
+// Everything a thread needs to process graphs (so that threads don't share any working memory)
+// Graphs are counted as they come and collected in a group (of graphs on the same number of vertices), and
+//  the b's of the whole group are evaluated and checked when it is flushed
+typedef struct Scratch {
+    unsigned int *results; // the results for graph j of the group start at results[j * RESULTS_SIZE(MAX_N)]
+    uint128 *bFast;        // the b's for graph j of the group start at bFast[j * NUM_BS(MAX_N)]
+    int groupN;            // number of vertices of the graphs in the group
+    int groupSize;
+    int lines[EVAL_GROUP_SIZE];
+    // With -g, the graphs of the batch being processed (the one on line l is generated[l - generatedFirstLine]),
+    //  so that the graphs we report can be printed; NULL otherwise
+    const Graph *generated;
+    int generatedFirstLine;
+    unsigned int fails[MAX_COLOURS(MAX_N)]; // verdict for the current graph (see printFailures)
+    SubsetTables tables;
+    mpz_t *b;
+    int agree[EVAL_GROUP_SIZE]; // 0 if the two ways of counting disagree for graph j of the group (see CROSS_CHECK_COUNTS)
+    #ifdef CROSS_CHECK_COUNTS
+        unsigned int *checkResults;
+    #endif
+    // Used with -i and -d (see countContraction)
+    Graph prev;                // the last graph counted, if prevN > 0
+    int prevN;
+    unsigned int *prevResults; // the counts for prev
+    unsigned int *contracted;
+    unsigned int *merged;
+    unsigned int *rest;
+    // Used with -d
+    unsigned int *deleted;          // the results for g - uv
+    mpz_t *dcTerms[NUM_DC_TERMS + 1]; // the terms for one k (with GMP), followed by a sequence made from them
+    mpz_t dcSum;
+} Scratch;
+
+
+void initScratch (Scratch *sc) {
+    sc->results = (unsigned int*)malloc(sizeof(unsigned int) * EVAL_GROUP_SIZE * RESULTS_SIZE(MAX_N));
+    sc->bFast = (uint128*)malloc(sizeof(uint128) * EVAL_GROUP_SIZE * NUM_BS(MAX_N));
+    sc->groupSize = 0;
+    sc->generated = NULL;
+    initSubsetTables(&sc->tables);
+    sc->b = (mpz_t*)malloc(sizeof(mpz_t) * MAX_COLOURS(MAX_N));
+    for (int i = 0; i < MAX_COLOURS(MAX_N); i += 1) {
+        mpz_init(sc->b[i]);
+    }
+    #ifdef CROSS_CHECK_COUNTS
+        sc->checkResults = (unsigned int*)malloc(sizeof(unsigned int) * RESULTS_SIZE(MAX_N));
+    #endif
+    sc->prevN = 0;
+    sc->prevResults = (unsigned int*)malloc(sizeof(unsigned int) * RESULTS_SIZE(MAX_N));
+    sc->contracted = (unsigned int*)malloc(sizeof(unsigned int) * RESULTS_SIZE(MAX_N));
+    sc->merged = (unsigned int*)malloc(sizeof(unsigned int) * RESULTS_SIZE(MAX_N));
+    sc->rest = (unsigned int*)malloc(sizeof(unsigned int) * RESULTS_SIZE(MAX_N));
+    sc->deleted = (unsigned int*)malloc(sizeof(unsigned int) * RESULTS_SIZE(MAX_N));
+    for (int p = 0; p <= NUM_DC_TERMS; p += 1) {
+        sc->dcTerms[p] = (mpz_t*)malloc(sizeof(mpz_t) * MAX_COLOURS(MAX_N));
+        for (int j = 0; j < MAX_COLOURS(MAX_N); j += 1) {
+            mpz_init(sc->dcTerms[p][j]);
+        }
+    }
+    mpz_init(sc->dcSum);
+}
+
 
-    strcpy(filepath, "graph_data/connected/graphs_");
-    if (0 <= n && n <= 99) {
-        int pos = 18;
-        if (n > 9) {
-            filepath[pos++] = (n / 10) + '0';
+void freeScratch (Scratch *sc) {
+    for (int i = 0; i < MAX_COLOURS(MAX_N); i += 1) {
+        mpz_clear(sc->b[i]);
+    }
+    free(sc->b);
+    free(sc->bFast);
+    free(sc->results);
+    freeSubsetTables(&sc->tables);
+    #ifdef CROSS_CHECK_COUNTS
+        free(sc->checkResults);
+    #endif
+    free(sc->prevResults);
+    free(sc->contracted);
+    free(sc->merged);
+    free(sc->rest);
+    free(sc->deleted);
+    for (int p = 0; p <= NUM_DC_TERMS; p += 1) {
+        for (int j = 0; j < MAX_COLOURS(MAX_N); j += 1) {
+            mpz_clear(sc->dcTerms[p][j]);
         }
-        filepath[pos++] = (n % 10) + '0';
-        strcpy(&filepath[pos], ".g6");
-    } else {
-        printf("Error in openGraphDataFile: Value of 'n', %d, not in range 0..99.", n);
-        free(filepath);
-        return -1;
+        free(sc->dcTerms[p]);
     }
+    mpz_clear(sc->dcSum);
+}
 
-    int fileDesc = open(filepath, O_RDONLY);
-    if (fileDesc < 0) {
-        printf("Failed to open intput file.\n");
-        printf("%s\n", strerror(errno));
-        printf("Filepath: %s", filepath);
+
+// With -g, print (to 'out') the g6 string of the graph on 'line', since the line number alone doesn't say which
+//  graph it is
+void printGenerated (int line, const Scratch *sc, OutBuf *out) {
+    if (sc->generated == NULL) {
+        return;
     }
-    free(filepath);
-    return fileDesc;
+    const Graph *g = &sc->generated[line - sc->generatedFirstLine];
+    char text[g6EncodedLength(MAX_N) + 1];
+    g6EncodeGraph(g, text);
+    text[g6EncodedLength(g->nVerts)] = '\0';
+    bufPrintf(out, "line = %d -- graph = %s\n", line, text);
 }
 
 
-int main () {
-    // Initialise everything
-    Graph g;
-    g.adjMat = (char*)malloc(sizeof(char) * ADJ_MAT_SIZE);
-    mpz_t *b = (mpz_t*)malloc(sizeof(mpz_t) * MAX_COLOURS);
-    for (int i = 0; i < MAX_COLOURS; i += 1) {
-        mpz_init(b[i]);
+// Print everything we found out about the graph on 'line' (with n vertices and the given verdict)
+void reportGraph (int line, int n, int agree, const unsigned int *fails, const Scratch *sc, OutBuf *out) {
+    if (!agree) {
+        bufPrintf(out, "Partition counts disagree at line = %d\n", line);
+    }
+    printFailures(line, n, fails, out);
+    int failed = !agree;
+    for (int k = 0; k < MAX_COLOURS(n); k += 1) {
+        failed |= (fails[k] != 0);
+    }
+    if (failed) {
+        printGenerated(line, sc, out);
     }
 
-    int in = openGraphDataFile(N);
-    #ifdef WRITE_RESULTS_TO_FILE
-        int out = open("graph_data/graphs_10_data_c.txt", O_WRONLY | O_CREAT, FILE_PERMISSIONS);
+    // Show progress in stdout
+    if (line % 1000 == 0) {
+        bufPrintf(out, "At line: %d\n", line);
+    }
+}
+
+
+// Evaluate the b's for the graphs in the group and check log-concavity for each k, appending any output to 'out'
+void flushGroup (Scratch *sc, OutBuf *out) {
+    int n = sc->groupN;
+    #ifndef ALWAYS_USE_GMP
+        evalBs(n, sc->groupSize, sc->results, sc->bFast);
     #endif
 
-    int *results = (int*)malloc(sizeof(int) * RESULTS_SIZE);
+    for (int j = 0; j < sc->groupSize; j += 1) {
+        unsigned int *results = &sc->results[j * RESULTS_SIZE(MAX_N)];
+        for (int k = 0; k < MAX_COLOURS(n); k += 1) {
+            #ifndef ALWAYS_USE_GMP
+                if (checkLogConcFast(k, n, &sc->bFast[j * NUM_BS(MAX_N) + k * MAX_COLOURS(n)], &sc->fails[k])) {
+                    continue;
+                }
+            #endif
+            computeBs(k, n, results, sc->b);
+            sc->fails[k] = checkLogConc(k, n, sc->b);
+        }
+        if (resultsCache != NULL) {
+            cacheInsert(resultsCache, results, RESULTS_SIZE(n), sc->fails, MAX_COLOURS(n));
+        }
+
+        reportGraph(sc->lines[j], n, sc->agree[j], sc->fails, sc, out);
+    }
+    sc->groupSize = 0;
+}
+
+
+// Add the results table in the next free slot of the group (starting at sc->results[sc->groupSize * RESULTS_SIZE(MAX_N)]),
+//  for a graph on n vertices from 'line', to the group (flushing the group first if its graphs have a different number
+//  of vertices, and afterwards if the group is full)
+// If the verdict for the table is already in the cache, the graph is reported right away (after the group) instead
+// Any output is appended to 'out'
+void addResults (int line, int n, Scratch *sc, OutBuf *out) {
+    // Flushing leaves the table alone (it is past the end of the group), but the group starts over at slot 0, so
+    //  the table is moved there (without groups, the group is always empty here)
+    #ifdef EVAL_BS_BY_GROUP
+        if (sc->groupSize > 0 && sc->groupN != n) {
+            int from = sc->groupSize;
+            flushGroup(sc, out);
+            memmove(sc->results, &sc->results[from * RESULTS_SIZE(MAX_N)], sizeof(unsigned int) * RESULTS_SIZE(n));
+            sc->agree[0] = sc->agree[from];
+        }
+    #endif
+    int j = sc->groupSize;
+    unsigned int *results = &sc->results[j * RESULTS_SIZE(MAX_N)];
+
+    // Looked up into a local array, since flushing the group overwrites sc->fails
+    unsigned int fails[MAX_COLOURS(MAX_N)];
+    if (resultsCache != NULL && cacheLookup(resultsCache, results, RESULTS_SIZE(n), fails, MAX_COLOURS(n))) {
+        if (sc->groupSize > 0) {
+            flushGroup(sc, out);
+        }
+        reportGraph(line, n, sc->agree[j], fails, sc, out);
+        return;
+    }
+
+    sc->groupN = n;
+    sc->lines[j] = line;
+    sc->groupSize += 1;
+    if (sc->groupSize == EVAL_GROUP_SIZE) {
+        flushGroup(sc, out);
+    }
+}
+
+
+// Same as evalChromatic, but with 128-bit integers
+// Returns 1 on success, or 0 if some value is at least 2^58 (so the sequences made from them might not fit in 63 bits)
+int evalChromaticFast (int k, int n, const unsigned int *results, uint128 *P) {
+    uint128 sums[RESULTS_ROWS(MAX_N)];
+    int rows = min(RESULTS_ROWS(n), k + 1);
+    for (int t = 0; t < rows; t += 1) {
+        sums[t] = 0;
+        for (int s = 0; s < RESULTS_COLS(n); s += 1) {
+            sums[t] += (uint128) fallingFacts[k - t][s] * results[(n + 1) * t + s];
+        }
+        if ((sums[t] >> 64) != 0) {
+            return 0;
+        }
+    }
+    for (int j = 0; j <= k; j += 1) {
+        P[j] = 0;
+        for (int t = 0; t < rows; t += 1) {
+            P[j] += fallingFacts[k - j][t] * sums[t];
+        }
+        if ((P[j] >> 58) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+// Set P[j] to P(H;k,j) for j = 0,...,k, where H is a graph on n vertices with the given results and 'sum' is
+//  scratch space
+// The two-variable chromatic polynomial P(H;x,y) counts the colourings of V(H) with x colours in which each of the
+//  first y colours is used on a stable set. Given the partition into colour classes, with t non-stable and s stable
+//  parts, the non-stable parts get distinct colours from the last x - y and the stable parts distinct colours from
+//  the remaining x - t, so
+//
+//      P(H;k,j) = sum_{t,s} (k-j)_t (k-t)_s results[t][s]
+//
+// (This isn't the same as the b's, where the non-stable parts may use the first colours.)
+// Assumes k < FF_SIZE
+void evalChromatic (int k, int n, const unsigned int *results, mpz_t *P, mpz_t sum) {
+    int rows = min(RESULTS_ROWS(n), k + 1);
+    for (int j = 0; j <= k; j += 1) {
+        mpz_set_ui(P[j], 0);
+    }
+    for (int t = 0; t < rows; t += 1) {
+        mpz_set_ui(sum, 0);
+        for (int s = 0; s < RESULTS_COLS(n); s += 1) {
+            mpz_addmul_ui(sum, fallingFactsZ[k - t][s], results[(n + 1) * t + s]);
+        }
+        for (int j = 0; j <= k; j += 1) {
+            mpz_addmul(P[j], fallingFactsZ[k - j][t], sum);
+        }
+    }
+}
+
 
-    if (in >= 0) {
-        LLLst *prtns = partitionsList(N);
-        int count = 0;
-        int printCount = 0;
-        while (readGraph(in, &g) != 0) {
-            count += 1;
+// Same as checkDCSeqs, but with 128-bit integers
+// Returns -2 if the terms are too large for this (see evalChromaticFast)
+int checkDCSeqsFast (int k, const unsigned int **tables, const int *nVerts) {
+    __int128 terms[NUM_DC_TERMS][MAX_COLOURS(MAX_N)];
+    for (int p = 0; p < NUM_DC_TERMS; p += 1) {
+        uint128 P[MAX_COLOURS(MAX_N)];
+        if (!evalChromaticFast(k, nVerts[p], tables[p], P)) {
+            return -2;
+        }
+        for (int j = 0; j <= k; j += 1) {
+            // (k - j) P < 2^62 since k <= 16, so the sums of two terms fit in 63 bits and their products in 126 bits
+            terms[p][j] = (p == DC_EXT) ? (__int128) P[j] * (k - j) : (__int128) P[j];
+        }
+    }
 
-            for (int i = 0; i < RESULTS_SIZE; i += 1) {
-                results[i] = 0;
+    for (int q = 0; q < NUM_DC_SEQS; q += 1) {
+        __int128 seq[MAX_COLOURS(MAX_N)];
+        for (int j = 0; j <= k; j += 1) {
+            seq[j] = 0;
+            for (int p = 0; p < NUM_DC_TERMS; p += 1) {
+                seq[j] += dcSeqCoefs[q][p] * terms[p][j];
             }
+        }
+        for (int x = 0, y = 1, z = 2; z <= k; x += 1, y += 1, z += 1) {
+            if (seq[y] * seq[y] < seq[x] * seq[z]) {
+                return q;
+            }
+        }
+    }
+    return -1;
+}
 
-            countPartitions(prtns, &g, results);
-            #ifdef WRITE_RESULTS_TO_FILE
-                writeGraphResults(out, results)
-            #endif
-            for (int k = 0; k < MAX_COLOURS; k += 1) {
-                computeBs(k, results, b);
-                checkLogConc(count, k, b);
+
+// Returns the first of the sequences for k (see dcSeqNames) which isn't log-concave, or -1 if they all are
+// tables[p] is the results for term p of the recurrence (G - e, G/e and G - u - v) and nVerts[p] its number of vertices
+int checkDCSeqs (int k, const unsigned int **tables, const int *nVerts, Scratch *sc) {
+    for (int p = 0; p < NUM_DC_TERMS; p += 1) {
+        evalChromatic(k, nVerts[p], tables[p], sc->dcTerms[p], sc->dcSum);
+    }
+    for (int j = 0; j <= k; j += 1) {
+        mpz_mul_ui(sc->dcTerms[DC_EXT][j], sc->dcTerms[DC_EXT][j], k - j);
+    }
+
+    mpz_t *seq = sc->dcTerms[NUM_DC_TERMS];
+    for (int q = 0; q < NUM_DC_SEQS; q += 1) {
+        for (int j = 0; j <= k; j += 1) {
+            mpz_set_ui(seq[j], 0);
+            for (int p = 0; p < NUM_DC_TERMS; p += 1) {
+                if (dcSeqCoefs[q][p] > 0) {
+                    mpz_addmul_ui(seq[j], sc->dcTerms[p][j], dcSeqCoefs[q][p]);
+                } else {
+                    mpz_submul_ui(seq[j], sc->dcTerms[p][j], -dcSeqCoefs[q][p]);
+                }
             }
+        }
+        for (int x = 0, y = 1, z = 2; z <= k; x += 1, y += 1, z += 1) {
+            mpz_mul(sc->dcSum, seq[x], seq[z]);
+            mpz_neg(sc->dcSum, sc->dcSum);
+            mpz_addmul(sc->dcSum, seq[y], seq[y]);
+            if (mpz_sgn(sc->dcSum) < 0) {
+                return q;
+            }
+        }
+    }
+    return -1;
+}
+
+
+// Check the sequences of the deletion-contraction recurrence for every edge of g (on 'line', with the given results),
+//  appending the first failure (if any) and progress to 'out'
+// 'agree' is 0 if the two ways of counting g disagree (see CROSS_CHECK_COUNTS)
+// Assumes 1 <= g->nVerts <= MAX_N
+void checkDeletionContraction (Graph *g, int line, const unsigned int *results, int agree, Scratch *sc, OutBuf *out) {
+    int n = g->nVerts;
+    const unsigned int *tables[NUM_DC_TERMS] = {sc->deleted, sc->contracted, sc->rest};
+    const int nVerts[NUM_DC_TERMS] = {n, n - 1, n - 2};
+    if (!agree) {
+        bufPrintf(out, "Partition counts disagree at line = %d\n", line);
+    }
 
-            // Show progress in stdout
-            printCount += 1;
-            if (printCount >= 1000) {
-                printf("At line: %d\n", count);
-                fflush(stdout);
-                printCount = 0;
+    int failed = -1;
+    for (int u = 0; u < n && failed < 0; u += 1) {
+        for (VertexSet rest = g->nbrs[u] & ~ALL_VERTICES(u + 1); rest != 0 && failed < 0; rest &= rest - 1) {
+            int v = __builtin_ctzll(rest);
+            countContraction(g, u, v, sc->contracted, sc->merged, sc->rest, &sc->tables);
+            memcpy(sc->deleted, results, sizeof(unsigned int) * RESULTS_SIZE(n));
+            moveMergedPartitions(sc->deleted, n, sc->merged, 0);
+
+            for (int k = 1; k <= n && failed < 0; k += 1) {
+                failed = -2;
+                #ifndef ALWAYS_USE_GMP
+                    failed = checkDCSeqsFast(k, tables, nVerts);
+                #endif
+                if (failed == -2) {
+                    failed = checkDCSeqs(k, tables, nVerts, sc);
+                }
+                if (failed >= 0) {
+                    bufPrintf(out, "line = %d -- edge = %d-%d -- k = %d -- %s is not log-concave\n", line, u, v, k, dcSeqNames[failed]);
+                }
             }
         }
-        freeLLLst(prtns);
     }
+    if (!agree || failed >= 0) {
+        printGenerated(line, sc, out);
+    }
+
+    // Show progress in stdout
+    if (line % 1000 == 0) {
+        bufPrintf(out, "At line: %d\n", line);
+    }
+}
+
+
+// Count the partitions of V(g) into 'results' from the counts for the previous graph counted by the thread, one
+//  edge in which the two graphs differ at a time (see "Adding and contracting an edge")
+// Returns 1 on success, or 0 (leaving 'results' alone) if the previous graph has a different number of vertices or
+//  the two differ in more than MAX_INCREMENTAL_EDGES edges
+int countFromPrevious (Graph *g, unsigned int *results, Scratch *sc) {
+    int n = g->nVerts;
+    Graph *cur = &sc->prev;
+    if (sc->prevN != n) {
+        return 0;
+    }
+    int changes = 0;
+    for (int v = 0; v < n; v += 1) {
+        changes += __builtin_popcountll(g->nbrs[v] ^ cur->nbrs[v]);
+    }
+    if (changes / 2 > MAX_INCREMENTAL_EDGES) {
+        return 0;
+    }
+
+    // Turn prev into g an edge at a time (prev is replaced by g afterwards anyway)
+    memcpy(results, sc->prevResults, sizeof(unsigned int) * RESULTS_SIZE(n));
+    for (int u = 0; u < n; u += 1) {
+        for (VertexSet rest = (g->nbrs[u] ^ cur->nbrs[u]) & ~ALL_VERTICES(u + 1); rest != 0; rest &= rest - 1) {
+            int v = __builtin_ctzll(rest);
+            countContraction(cur, u, v, sc->contracted, sc->merged, sc->rest, &sc->tables);
+            moveMergedPartitions(results, n, sc->merged, graphHasEdge(g, u, v));
+            cur->nbrs[u] ^= VERTEX_BIT(v);
+            cur->nbrs[v] ^= VERTEX_BIT(u);
+        }
+    }
+    return 1;
+}
 
-    close(in);
-    #ifdef WRITE_RESULTS_TO_FILE
-        close(out);
+
+// Count the partitions of V(g) and check log-concavity (see addResults), or with -d check the sequences of the
+//  deletion-contraction recurrence (see checkDeletionContraction)
+// 'line' is the line of the input g was read from, and any output is appended to 'out'
+// Returns the counts for g (which stay valid until the next call)
+// Assumes 1 <= g->nVerts <= MAX_N
+unsigned int *processGraph (Graph *g, int line, Scratch *sc, OutBuf *out) {
+    int n = g->nVerts;
+    int j = sc->groupSize;
+    unsigned int *results = &sc->results[j * RESULTS_SIZE(MAX_N)];
+    for (int i = 0; i < RESULTS_SIZE(n); i += 1) {
+        results[i] = 0;
+    }
+
+    if (!incremental || !countFromPrevious(g, results, sc)) {
+        #ifdef COUNT_BY_ENUMERATION
+            countPartitionsEnum(g, results);
+        #else
+            countPartitionsDP(g, results, &sc->tables);
+        #endif
+    }
+    #ifdef CROSS_CHECK_COUNTS
+        for (int i = 0; i < RESULTS_SIZE(n); i += 1) {
+            sc->checkResults[i] = 0;
+        }
+        countPartitionsEnum(g, sc->checkResults);
+        sc->agree[j] = (memcmp(results, sc->checkResults, sizeof(unsigned int) * RESULTS_SIZE(n)) == 0);
+    #else
+        sc->agree[j] = 1;
     #endif
-    free(b);
-    free(results);
-    free(g.adjMat);
-}
\ No newline at end of file
+    if (incremental) {
+        sc->prev = *g;
+        sc->prevN = n;
+        memcpy(sc->prevResults, results, sizeof(unsigned int) * RESULTS_SIZE(n));
+    }
+
+    if (deletionContraction) {
+        checkDeletionContraction(g, line, results, sc->agree[j], sc, out);
+    } else {
+        addResults(line, n, sc, out);
+    }
+    return results;
+}
+
+
+/* Parallel pipeline:
+ * The main thread splits the input into batches of (up to) BATCH_SIZE lines, worker threads each take a
+ *  whole batch at a time (decoding the graphs and collecting the output in the batch), and a writer thread
+ *  prints the batches in the order they were read (so the output is exactly what a single thread would print).
+ * When the graphs are generated (-g) rather than read, the main thread fills the batches with the graphs
+ *  themselves instead of lines, numbering them in the order they were made.
+ * Batches live in a ring of 'nBatches' slots; the batch with sequence number i is kept in slot i % nBatches.
+ *  Batches [nextWrite, nextRead) have been read but not yet written, and of those the ones before nextWork
+ *  have been (or are being) handled by a worker.
+ */
+typedef struct Batch {
+    int firstLine; // line number of lines[0]
+    int nGraphs;
+    int done;      // 1 once a worker has finished with the batch
+    G6Line lines[BATCH_SIZE];
+    Graph *graphs; // the graphs themselves instead of lines (only when generating them)
+    OutBuf out;
+    // Only used when writing the results to a file
+    unsigned int *results; // the results for lines[i] start at results[i * RESULTS_SIZE(MAX_N)]
+    int *nVerts;           // the number of vertices of the graph on lines[i] (0 if it was skipped)
+} Batch;
+
+typedef struct Pipeline {
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // signalled whenever any of the fields below change
+    Batch *batches;
+    int nBatches;
+    long nextRead;
+    long nextWork;
+    long nextWrite;
+    int doneReading;
+    int generating;            // 1 if the batches hold graphs rather than lines
+    ResultsWriter *resultsOut; // where to write the results, or NULL
+    pthread_t *workers;
+    int nThreads;
+    pthread_t writer;
+} Pipeline;
+
+
+void *workerThread (void *arg) {
+    Pipeline *pl = (Pipeline*)arg;
+    Graph g;
+    Scratch sc;
+    initScratch(&sc);
+
+    pthread_mutex_lock(&pl->lock);
+    while (1) {
+        while (pl->nextWork == pl->nextRead && !pl->doneReading) {
+            pthread_cond_wait(&pl->changed, &pl->lock);
+        }
+        if (pl->nextWork == pl->nextRead) {
+            break; // Nothing left to read
+        }
+        Batch *batch = &pl->batches[pl->nextWork % pl->nBatches];
+        pl->nextWork += 1;
+        pthread_mutex_unlock(&pl->lock);
+
+        batch->out.len = 0;
+        sc.generated = batch->graphs;
+        sc.generatedFirstLine = batch->firstLine;
+        for (int i = 0; i < batch->nGraphs; i += 1) {
+            int line = batch->firstLine + i;
+            int err = G6_OK;
+            if (batch->graphs != NULL) {
+                g = batch->graphs[i];
+            } else {
+                err = g6DecodeGraph(batch->lines[i].text, batch->lines[i].len, &g);
+            }
+            if (err != G6_OK || g.nVerts < 1 || g.nVerts > MAX_N) {
+                // Skip the graph
+                if (err != G6_OK) {
+                    fprintf(stderr, "Skipping line %d: %s\n", line, g6ErrorString(err));
+                } else {
+                    fprintf(stderr, "Skipping line %d: graph has %d vertices (must be 1 to %d)\n", line, g.nVerts, MAX_N);
+                }
+                g.nVerts = 0;
+            } else {
+                unsigned int *results = processGraph(&g, line, &sc, &batch->out);
+                if (pl->resultsOut != NULL) {
+                    memcpy(&batch->results[i * RESULTS_SIZE(MAX_N)], results, sizeof(unsigned int) * RESULTS_SIZE(g.nVerts));
+                }
+            }
+            if (pl->resultsOut != NULL) {
+                batch->nVerts[i] = g.nVerts;
+            }
+        }
+        if (sc.groupSize > 0) {
+            flushGroup(&sc, &batch->out);
+        }
+
+        pthread_mutex_lock(&pl->lock);
+        batch->done = 1;
+        pthread_cond_broadcast(&pl->changed);
+    }
+    pthread_mutex_unlock(&pl->lock);
+
+    freeScratch(&sc);
+    return NULL;
+}
+
+
+void *writerThread (void *arg) {
+    Pipeline *pl = (Pipeline*)arg;
+
+    pthread_mutex_lock(&pl->lock);
+    while (1) {
+        Batch *batch = &pl->batches[pl->nextWrite % pl->nBatches];
+        while (!(pl->nextWrite < pl->nextRead && batch->done) && !(pl->doneReading && pl->nextWrite == pl->nextRead)) {
+            pthread_cond_wait(&pl->changed, &pl->lock);
+        }
+        if (pl->nextWrite == pl->nextRead) {
+            break; // Everything has been read and written
+        }
+        pthread_mutex_unlock(&pl->lock);
+
+        fwrite(batch->out.text, sizeof(char), batch->out.len, stdout);
+        fflush(stdout);
+        for (int i = 0; pl->resultsOut != NULL && i < batch->nGraphs; i += 1) {
+            if (batch->nVerts[i] > 0 && resultsWrite(pl->resultsOut, batch->firstLine + i, batch->nVerts[i], &batch->results[i * RESULTS_SIZE(MAX_N)]) != 0) {
+                fprintf(stderr, "Couldn't write the results for line %d: %s\n", batch->firstLine + i, strerror(errno));
+            }
+        }
+
+        pthread_mutex_lock(&pl->lock);
+        batch->done = 0;
+        pl->nextWrite += 1;
+        pthread_cond_broadcast(&pl->changed);
+    }
+    pthread_mutex_unlock(&pl->lock);
+    return NULL;
+}
+
+
+// Start 'nThreads' worker threads and the writer thread (pl->generating and pl->resultsOut must be set)
+void startPipeline (int nThreads, Pipeline *pl) {
+    pl->nBatches = BATCHES_PER_THREAD * nThreads;
+    pl->batches = (Batch*)malloc(sizeof(Batch) * pl->nBatches);
+    for (int i = 0; i < pl->nBatches; i += 1) {
+        pl->batches[i].done = 0;
+        pl->batches[i].out.cap = 256;
+        pl->batches[i].out.len = 0;
+        pl->batches[i].out.text = (char*)malloc(sizeof(char) * pl->batches[i].out.cap);
+        pl->batches[i].graphs = NULL;
+        pl->batches[i].results = NULL;
+        pl->batches[i].nVerts = NULL;
+        if (pl->generating) {
+            pl->batches[i].graphs = (Graph*)malloc(sizeof(Graph) * BATCH_SIZE);
+        }
+        if (pl->resultsOut != NULL) {
+            pl->batches[i].results = (unsigned int*)malloc(sizeof(unsigned int) * BATCH_SIZE * RESULTS_SIZE(MAX_N));
+            pl->batches[i].nVerts = (int*)malloc(sizeof(int) * BATCH_SIZE);
+        }
+    }
+    pl->nextRead = pl->nextWork = pl->nextWrite = 0;
+    pl->doneReading = 0;
+    pthread_mutex_init(&pl->lock, NULL);
+    pthread_cond_init(&pl->changed, NULL);
+
+    pl->nThreads = nThreads;
+    pl->workers = (pthread_t*)malloc(sizeof(pthread_t) * nThreads);
+    for (int t = 0; t < nThreads; t += 1) {
+        pthread_create(&pl->workers[t], NULL, workerThread, pl);
+    }
+    pthread_create(&pl->writer, NULL, writerThread, pl);
+}
+
+
+// Wait for a free batch to fill
+Batch *nextFreeBatch (Pipeline *pl) {
+    pthread_mutex_lock(&pl->lock);
+    while (pl->nextRead - pl->nextWrite >= pl->nBatches) {
+        pthread_cond_wait(&pl->changed, &pl->lock);
+    }
+    Batch *batch = &pl->batches[pl->nextRead % pl->nBatches];
+    pthread_mutex_unlock(&pl->lock);
+    return batch;
+}
+
+
+// Hand the batch from nextFreeBatch (filled in, but possibly empty) to the workers
+// 'last' is 1 if there are no more batches after this one
+void submitBatch (Pipeline *pl, Batch *batch, int last) {
+    pthread_mutex_lock(&pl->lock);
+    if (batch->nGraphs > 0) {
+        pl->nextRead += 1;
+    }
+    pl->doneReading = last;
+    pthread_cond_broadcast(&pl->changed);
+    pthread_mutex_unlock(&pl->lock);
+}
+
+
+// Wait for everything submitted to be processed and written, and free the pipeline
+void finishPipeline (Pipeline *pl) {
+    for (int t = 0; t < pl->nThreads; t += 1) {
+        pthread_join(pl->workers[t], NULL);
+    }
+    pthread_join(pl->writer, NULL);
+    free(pl->workers);
+
+    pthread_mutex_destroy(&pl->lock);
+    pthread_cond_destroy(&pl->changed);
+    for (int i = 0; i < pl->nBatches; i += 1) {
+        free(pl->batches[i].out.text);
+        free(pl->batches[i].graphs);
+        free(pl->batches[i].results);
+        free(pl->batches[i].nVerts);
+    }
+    free(pl->batches);
+}
+
+
+// Process the graphs in the lines of 'cur' with 'nThreads' worker threads
+// 'firstLine' is the line number (in the whole file) of the first line of 'cur'
+void runPipeline (G6Cursor *cur, int firstLine, int nThreads, Pipeline *pl) {
+    pl->generating = 0;
+    startPipeline(nThreads, pl);
+
+    int count = firstLine - 1;
+    int finished = 0;
+    while (!finished) {
+        Batch *batch = nextFreeBatch(pl);
+        batch->firstLine = count + 1;
+        batch->nGraphs = 0;
+        while (batch->nGraphs < BATCH_SIZE && g6NextLine(cur, &batch->lines[batch->nGraphs]) != 0) {
+            batch->nGraphs += 1;
+        }
+        count += batch->nGraphs;
+        finished = (batch->nGraphs < BATCH_SIZE);
+        submitBatch(pl, batch, finished);
+    }
+
+    finishPipeline(pl);
+}
+
+
+// State of generatePipeline while the graphs are being made
+typedef struct GenerationState {
+    Pipeline *pl;
+    Batch *batch; // the batch being filled
+    int count;    // number of graphs made so far
+} GenerationState;
+
+
+// Add a graph which was just made to the batch being filled (see generateConnected)
+void addGeneratedGraph (void *arg, const Graph *g) {
+    GenerationState *state = (GenerationState*)arg;
+    Batch *batch = state->batch;
+    batch->graphs[batch->nGraphs] = *g;
+    batch->nGraphs += 1;
+    state->count += 1;
+    if (batch->nGraphs == BATCH_SIZE) {
+        submitBatch(state->pl, batch, 0);
+        state->batch = nextFreeBatch(state->pl);
+        state->batch->firstLine = state->count + 1;
+        state->batch->nGraphs = 0;
+    }
+}
+
+
+// Process the connected graphs on n vertices (one from each isomorphism class) in piece 'shard' of 'nShards'
+//  of the generation (see graphgen.h) with 'nThreads' worker threads
+// The graphs are numbered from 1 in the order they are made, and their numbers are reported as their lines
+void generatePipeline (int n, int shard, int nShards, int nThreads, Pipeline *pl) {
+    pl->generating = 1;
+    startPipeline(nThreads, pl);
+
+    GenerationState state = {pl, nextFreeBatch(pl), 0};
+    state.batch->firstLine = 1;
+    state.batch->nGraphs = 0;
+    generateConnected(n, shard, nShards, addGeneratedGraph, &state);
+    submitBatch(pl, state.batch, 1);
+
+    finishPipeline(pl);
+}
+
+
+// Check log-concavity for the results tables stored in the results file at 'path' (written with -o), instead
+//  of counting partitions again
+void checkResultsFile (const char *path) {
+    int err;
+    ResultsReader *in = resultsOpen(path, &err);
+    if (in == NULL) {
+        printf("Error opening results file: %s\n", (err == -1) ? strerror(errno) : resultsErrorString(err));
+        printf("Filepath: %s\n", path);
+        return;
+    }
+
+    Scratch sc;
+    initScratch(&sc);
+    unsigned int *record = (unsigned int*)malloc(sizeof(unsigned int) * RESULTS_SIZE(in->maxN));
+    OutBuf out = {(char*)malloc(256), 0, 256};
+    for (long i = 0; i < in->nRecords; i += 1) {
+        long line;
+        int n;
+        if (resultsRead(in, i, &line, &n, record) != 0 || n > MAX_N) {
+            fprintf(stderr, "Skipping record %ld: invalid, or a graph with more than %d vertices\n", i, MAX_N);
+            continue;
+        }
+        memcpy(&sc.results[sc.groupSize * RESULTS_SIZE(MAX_N)], record, sizeof(unsigned int) * RESULTS_SIZE(n));
+        sc.agree[sc.groupSize] = 1;
+        addResults(line, n, &sc, &out);
+
+        if ((i + 1) % BATCH_SIZE == 0) {
+            fwrite(out.text, sizeof(char), out.len, stdout);
+            out.len = 0;
+        }
+    }
+    if (sc.groupSize > 0) {
+        flushGroup(&sc, &out);
+    }
+    fwrite(out.text, sizeof(char), out.len, stdout);
+    fflush(stdout);
+
+    free(out.text);
+    free(record);
+    freeScratch(&sc);
+    resultsCloseReader(in);
+}
+
+
+void printUsage (char *progName) {
+    fprintf(stderr, "Usage: %s [-n n | -n first-last | -f file | -r resultsfile] [-g] [-j threads] [-s shard/shards]\n", progName);
+    fprintf(stderr, "       [-c | -C cachefile] [-o resultsfile [-z]] [-i] [-d]\n");
+    fprintf(stderr, "Checks log-concavity for graphs with 1 to %d vertices\n", MAX_N);
+    fprintf(stderr, "  -n n             check graph_data/connected/graphs_n.g6 (default n = %d)\n", DEFAULT_N);
+    fprintf(stderr, "  -n first-last    check graph_data/connected/graphs_n.g6 for n = first,...,last in turn\n");
+    fprintf(stderr, "  -f file          check the graphs in 'file' instead (\"-\" for standard input)\n");
+    fprintf(stderr, "  -g               generate the connected graphs on n vertices (one from each isomorphism class)\n");
+    fprintf(stderr, "                   instead of reading them from graph_data, numbering them in the order they are\n");
+    fprintf(stderr, "                   made (the g6 string of each graph which fails is printed with it); with -s,\n");
+    fprintf(stderr, "                   each shard generates its own part of the graphs\n");
+    fprintf(stderr, "  -j threads       number of worker threads (default 1)\n");
+    fprintf(stderr, "  -s shard/shards  split each file into 'shards' pieces (on line boundaries) and only check\n");
+    fprintf(stderr, "                   piece number 'shard' (from 0), e.g. to spread the work over several machines\n");
+    fprintf(stderr, "  -c               remember the verdict for each table of partition counts, and reuse it for\n");
+    fprintf(stderr, "                   later graphs with the same counts\n");
+    fprintf(stderr, "  -C cachefile     same as -c, but also load the verdicts from 'cachefile' (if it exists) at the\n");
+    fprintf(stderr, "                   start and save them there at the end\n");
+    fprintf(stderr, "  -o resultsfile   write the partition counts for each graph to 'resultsfile' (see results_file.h)\n");
+    fprintf(stderr, "  -z               compress the results file (it can still be read in any order, but more slowly)\n");
+    fprintf(stderr, "  -r resultsfile   check the partition counts stored in 'resultsfile' instead of reading graphs\n");
+    fprintf(stderr, "  -i               count each graph from the previous one (of the same thread) when they differ in\n");
+    fprintf(stderr, "                   at most %d edges, which is often the case for consecutive graphs with -g\n", MAX_INCREMENTAL_EDGES);
+    fprintf(stderr, "  -d               check the sequences from the deletion-contraction recurrence for each edge\n");
+    fprintf(stderr, "                   (section 6.2) instead, reporting the first one which isn't log-concave\n");
+    fprintf(stderr, "                   (can't be used with -c, -C or -r)\n");
+    fprintf(stderr, "The number of vertices of each graph is read from its g6 string.\n");
+}
+
+
+int main (int argc, char **argv) {
+    int nThreads = 1;
+    int shard = 0, nShards = 1;
+    int firstN = DEFAULT_N, lastN = DEFAULT_N;
+    char *inputPath = NULL;
+    int useCache = 0;
+    char *cachePath = NULL;
+    char *resultsPath = NULL;
+    int resultsFlags = 0;
+    char *storedPath = NULL;
+    int generate = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:f:j:s:cC:o:zr:gid")) != -1) {
+        if (opt == 'n' && sscanf(optarg, "%d-%d", &firstN, &lastN) >= 1) {
+            if (strchr(optarg, '-') == NULL) {
+                lastN = firstN;
+            }
+            if (firstN < 1 || lastN > MAX_N || firstN > lastN) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (opt == 'f') {
+            inputPath = optarg;
+        } else if (opt == 'j' && atoi(optarg) > 0) {
+            nThreads = atoi(optarg);
+        } else if (opt == 's' && sscanf(optarg, "%d/%d", &shard, &nShards) == 2 && 0 <= shard && shard < nShards) {
+            continue;
+        } else if (opt == 'c') {
+            useCache = 1;
+        } else if (opt == 'C') {
+            useCache = 1;
+            cachePath = optarg;
+        } else if (opt == 'o') {
+            resultsPath = optarg;
+        } else if (opt == 'z') {
+            resultsFlags |= RF_COMPRESSED;
+        } else if (opt == 'r') {
+            storedPath = optarg;
+        } else if (opt == 'g') {
+            generate = 1;
+        } else if (opt == 'i') {
+            incremental = 1;
+        } else if (opt == 'd') {
+            deletionContraction = 1;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if ((generate && (inputPath != NULL || storedPath != NULL)) || (deletionContraction && (useCache || storedPath != NULL))) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (inputPath != NULL || storedPath != NULL) {
+        firstN = lastN = 0; // Only one file to check
+    }
+
+    // Initialise everything
+    initCountingTables();
+    initFallingFacts();
+    initEvalPlans();
+    Pipeline pl;
+
+    if (useCache) {
+        resultsCache = cacheCreate(CACHE_MAX_ENTRIES);
+        if (cachePath != NULL) {
+            int err = cacheLoad(resultsCache, cachePath);
+            if (err == -2) {
+                fprintf(stderr, "Ignoring %s: not a cache file\n", cachePath);
+            } else if (err == -1 && errno != ENOENT) {
+                fprintf(stderr, "Couldn't read cache file %s: %s\n", cachePath, strerror(errno));
+            }
+        }
+    }
+
+    pl.resultsOut = NULL;
+    if (resultsPath != NULL) {
+        // Graphs from the data files have lastN vertices at most, but a given file could have up to MAX_N
+        pl.resultsOut = resultsCreate(resultsPath, (inputPath != NULL) ? MAX_N : lastN, resultsFlags);
+        if (pl.resultsOut == NULL) {
+            fprintf(stderr, "Couldn't create results file %s: %s\n", resultsPath, strerror(errno));
+            return 1;
+        }
+    }
+
+    if (storedPath != NULL) {
+        checkResultsFile(storedPath);
+    }
+    for (int n = firstN; n <= lastN && storedPath == NULL; n += 1) {
+        char filepath[64];
+        if (inputPath == NULL) {
+            snprintf(filepath, sizeof(filepath), "graph_data/connected/graphs_%d.g6", n);
+        }
+        if (firstN < lastN) {
+            printf("Checking graphs on %d vertices\n", n);
+            fflush(stdout);
+        }
+
+        if (generate) {
+            generatePipeline(n, shard, nShards, nThreads, &pl);
+            continue;
+        }
+        G6File *in = openGraphDataFile((inputPath != NULL) ? inputPath : filepath);
+        if (in != NULL) {
+            size_t bounds[nShards + 1];
+            g6SplitFile(in, nShards, bounds);
+            G6Cursor cur;
+            g6CursorInit(in, bounds[shard], bounds[shard + 1], &cur);
+            runPipeline(&cur, 1 + g6CountLines(in, 0, bounds[shard]), nThreads, &pl);
+            g6Close(in);
+        }
+    }
+
+    if (pl.resultsOut != NULL && resultsClose(pl.resultsOut) != 0) {
+        fprintf(stderr, "Couldn't finish results file %s: %s\n", resultsPath, strerror(errno));
+    }
+
+    if (resultsCache != NULL) {
+        long lookups, hits;
+        cacheStats(resultsCache, &lookups, &hits);
+        fprintf(stderr, "Cache: %ld hits out of %ld graphs (%.1f%%)\n", hits, lookups, (lookups > 0) ? 100.0 * hits / lookups : 0.0);
+        if (cachePath != NULL && cacheSave(resultsCache, cachePath) != 0) {
+            fprintf(stderr, "Couldn't save cache file %s: %s\n", cachePath, strerror(errno));
+        }
+        cacheFree(resultsCache);
+    }
+}
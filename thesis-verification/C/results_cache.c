@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "results_cache.h"
+
+/*
+ * Cache of verdicts keyed on results tables (see results_cache.h)
+ *
+ * Each shard is an open addressing hash table (with linear probing) of pointers to entries, which are stored
+ *  one after the other in large blocks. An entry is the array {keyLen, valueLen, key..., value...}.
+ */
+
+// Number of shards (a power of 2); the shard of a key is given by the top bits of its hash
+#define CACHE_SHARDS 64
+#define CACHE_SHARD_BITS 6
+
+// Number of unsigned ints in each block of entries
+#define BLOCK_WORDS (1 << 18)
+
+// Initial number of slots in each shard (a power of 2), and the most entries per slot before we grow
+#define INITIAL_SLOTS 256
+#define MAX_LOAD 0.5
+
+// Start of a cache file, and the longest keys and values we accept in one
+#define CACHE_FILE_MAGIC "LCCACHE1"
+#define CACHE_FILE_MAGIC_LEN 8
+#define MAX_FILE_ARRAY_LEN (1 << 16)
+
+typedef struct Block {
+    struct Block *next;
+    size_t used;
+    size_t size;
+    unsigned int words[];
+} Block;
+
+typedef struct Slot {
+    uint64_t hash;
+    unsigned int *entry; // NULL if the slot is empty
+} Slot;
+
+typedef struct Shard {
+    pthread_mutex_t lock;
+    Slot *slots;
+    size_t nSlots;
+    size_t count;
+    Block *blocks; // the block we're filling, followed by the full ones
+    long lookups;
+    long hits;
+} Shard;
+
+struct ResultsCache {
+    Shard shards[CACHE_SHARDS];
+    size_t maxPerShard;
+};
+
+
+static uint64_t hashKey (const unsigned int *key, int keyLen) {
+    // FNV-1a over whole words, followed by a final mix so that the top and bottom bits both depend on every word
+    uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t) keyLen;
+    for (int i = 0; i < keyLen; i += 1) {
+        h = (h ^ key[i]) * 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+
+static int entryMatches (const unsigned int *entry, const unsigned int *key, int keyLen) {
+    return entry[0] == (unsigned int) keyLen && memcmp(&entry[2], key, sizeof(unsigned int) * keyLen) == 0;
+}
+
+
+// Returns the slot holding 'key', or the empty slot where it would go
+static Slot *findSlot (Shard *shard, uint64_t hash, const unsigned int *key, int keyLen) {
+    size_t mask = shard->nSlots - 1;
+    for (size_t pos = hash & mask; ; pos = (pos + 1) & mask) {
+        Slot *slot = &shard->slots[pos];
+        if (slot->entry == NULL || (slot->hash == hash && entryMatches(slot->entry, key, keyLen))) {
+            return slot;
+        }
+    }
+}
+
+
+static void growShard (Shard *shard) {
+    Slot *old = shard->slots;
+    size_t oldSlots = shard->nSlots;
+    shard->nSlots *= 2;
+    shard->slots = (Slot*)calloc(shard->nSlots, sizeof(Slot));
+    size_t mask = shard->nSlots - 1;
+    for (size_t i = 0; i < oldSlots; i += 1) {
+        if (old[i].entry != NULL) {
+            size_t pos = old[i].hash & mask;
+            while (shard->slots[pos].entry != NULL) {
+                pos = (pos + 1) & mask;
+            }
+            shard->slots[pos] = old[i];
+        }
+    }
+    free(old);
+}
+
+
+// Returns space for an entry of 'words' unsigned ints
+static unsigned int *allocEntry (Shard *shard, size_t words) {
+    Block *block = shard->blocks;
+    if (block == NULL || block->size - block->used < words) {
+        size_t size = (words > BLOCK_WORDS) ? words : BLOCK_WORDS;
+        block = (Block*)malloc(sizeof(Block) + sizeof(unsigned int) * size);
+        block->used = 0;
+        block->size = size;
+        block->next = shard->blocks;
+        shard->blocks = block;
+    }
+    unsigned int *entry = &block->words[block->used];
+    block->used += words;
+    return entry;
+}
+
+
+ResultsCache *cacheCreate (size_t maxEntries) {
+    ResultsCache *cache = (ResultsCache*)malloc(sizeof(ResultsCache));
+    cache->maxPerShard = (maxEntries + CACHE_SHARDS - 1) / CACHE_SHARDS;
+    for (int i = 0; i < CACHE_SHARDS; i += 1) {
+        Shard *shard = &cache->shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->nSlots = INITIAL_SLOTS;
+        shard->slots = (Slot*)calloc(shard->nSlots, sizeof(Slot));
+        shard->count = 0;
+        shard->blocks = NULL;
+        shard->lookups = shard->hits = 0;
+    }
+    return cache;
+}
+
+
+void cacheFree (ResultsCache *cache) {
+    for (int i = 0; i < CACHE_SHARDS; i += 1) {
+        Shard *shard = &cache->shards[i];
+        pthread_mutex_destroy(&shard->lock);
+        free(shard->slots);
+        while (shard->blocks != NULL) {
+            Block *next = shard->blocks->next;
+            free(shard->blocks);
+            shard->blocks = next;
+        }
+    }
+    free(cache);
+}
+
+
+int cacheLookup (ResultsCache *cache, const unsigned int *key, int keyLen, unsigned int *value, int valueLen) {
+    uint64_t hash = hashKey(key, keyLen);
+    Shard *shard = &cache->shards[hash >> (64 - CACHE_SHARD_BITS)];
+
+    pthread_mutex_lock(&shard->lock);
+    shard->lookups += 1;
+    Slot *slot = findSlot(shard, hash, key, keyLen);
+    int found = (slot->entry != NULL && slot->entry[1] == (unsigned int) valueLen);
+    if (found) {
+        shard->hits += 1;
+        memcpy(value, &slot->entry[2 + keyLen], sizeof(unsigned int) * valueLen);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return found;
+}
+
+
+void cacheInsert (ResultsCache *cache, const unsigned int *key, int keyLen, const unsigned int *value, int valueLen) {
+    uint64_t hash = hashKey(key, keyLen);
+    Shard *shard = &cache->shards[hash >> (64 - CACHE_SHARD_BITS)];
+
+    pthread_mutex_lock(&shard->lock);
+    if (shard->count < cache->maxPerShard) {
+        if (shard->count + 1 > shard->nSlots * MAX_LOAD) {
+            growShard(shard);
+        }
+        Slot *slot = findSlot(shard, hash, key, keyLen);
+        if (slot->entry == NULL) {
+            unsigned int *entry = allocEntry(shard, 2 + keyLen + valueLen);
+            entry[0] = keyLen;
+            entry[1] = valueLen;
+            memcpy(&entry[2], key, sizeof(unsigned int) * keyLen);
+            memcpy(&entry[2 + keyLen], value, sizeof(unsigned int) * valueLen);
+            slot->hash = hash;
+            slot->entry = entry;
+            shard->count += 1;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+
+int cacheLoad (ResultsCache *cache, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    char magic[CACHE_FILE_MAGIC_LEN];
+    if (fread(magic, 1, CACHE_FILE_MAGIC_LEN, f) != CACHE_FILE_MAGIC_LEN || memcmp(magic, CACHE_FILE_MAGIC, CACHE_FILE_MAGIC_LEN) != 0) {
+        fclose(f);
+        return -2;
+    }
+
+    int status = 0;
+    unsigned int *data = (unsigned int*)malloc(sizeof(unsigned int) * 2 * MAX_FILE_ARRAY_LEN);
+    unsigned int lens[2];
+    while (fread(lens, sizeof(unsigned int), 2, f) == 2) {
+        if (lens[0] > MAX_FILE_ARRAY_LEN || lens[1] > MAX_FILE_ARRAY_LEN
+                || fread(data, sizeof(unsigned int), lens[0] + lens[1], f) != lens[0] + lens[1]) {
+            status = -2;
+            break;
+        }
+        cacheInsert(cache, data, lens[0], &data[lens[0]], lens[1]);
+    }
+    free(data);
+    fclose(f);
+    return status;
+}
+
+
+int cacheSave (ResultsCache *cache, const char *path) {
+    // Write to a temporary file first so that an interrupted save doesn't destroy the old cache
+    char *tmpPath = (char*)malloc(strlen(path) + 5);
+    sprintf(tmpPath, "%s.tmp", path);
+    FILE *f = fopen(tmpPath, "wb");
+    if (f == NULL) {
+        free(tmpPath);
+        return -1;
+    }
+
+    int ok = (fwrite(CACHE_FILE_MAGIC, 1, CACHE_FILE_MAGIC_LEN, f) == CACHE_FILE_MAGIC_LEN);
+    for (int i = 0; i < CACHE_SHARDS && ok; i += 1) {
+        Shard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        for (size_t j = 0; j < shard->nSlots && ok; j += 1) {
+            unsigned int *entry = shard->slots[j].entry;
+            if (entry != NULL) {
+                size_t words = 2 + entry[0] + entry[1];
+                ok = (fwrite(entry, sizeof(unsigned int), words, f) == words);
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    int err = errno;
+    if (fclose(f) != 0) {
+        ok = 0;
+        err = errno;
+    }
+    if (ok && rename(tmpPath, path) != 0) {
+        ok = 0;
+        err = errno;
+    }
+    if (!ok) {
+        remove(tmpPath);
+    }
+    free(tmpPath);
+    errno = err;
+    return ok ? 0 : -1;
+}
+
+
+void cacheStats (ResultsCache *cache, long *lookups, long *hits) {
+    *lookups = *hits = 0;
+    for (int i = 0; i < CACHE_SHARDS; i += 1) {
+        Shard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        *lookups += shard->lookups;
+        *hits += shard->hits;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
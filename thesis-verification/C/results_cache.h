@@ -0,0 +1,43 @@
+#ifndef RESULTS_CACHE_H
+#define RESULTS_CACHE_H
+
+#include <stddef.h>
+
+/*
+ * Cache of verdicts keyed on results tables, shared between threads
+ *
+ * Whether the b's of a graph are log-concave depends only on its results table, and many graphs share the
+ *  same table, so we remember the verdict for each table we've seen. Keys and values are arrays of unsigned
+ *  ints (of any length). The cache is split into shards, each with its own lock and hash table, so threads
+ *  rarely wait for each other. Once the cache holds maxEntries entries, new entries are no longer added.
+ * The cache can be saved to and loaded from a file (in the native byte order, so the file is only meant to
+ *  be read back on the same kind of machine).
+ */
+
+typedef struct ResultsCache ResultsCache;
+
+
+// Returns an empty cache which holds at most maxEntries entries
+ResultsCache *cacheCreate (size_t maxEntries);
+
+void cacheFree (ResultsCache *cache);
+
+// Look up 'key' (of keyLen unsigned ints), copying its value (valueLen unsigned ints) into 'value' if it is there
+// Returns 1 if the key was found, 0 otherwise
+int cacheLookup (ResultsCache *cache, const unsigned int *key, int keyLen, unsigned int *value, int valueLen);
+
+// Add 'key' with the given value (does nothing if the key is already there or the cache is full)
+void cacheInsert (ResultsCache *cache, const unsigned int *key, int keyLen, const unsigned int *value, int valueLen);
+
+// Add the entries saved in the file at 'path' (see cacheSave)
+// Returns 0 on success, -1 (with errno set) if the file couldn't be read, or -2 if it isn't a cache file
+int cacheLoad (ResultsCache *cache, const char *path);
+
+// Save all the entries in the file at 'path'
+// Returns 0 on success, -1 (with errno set) on failure
+int cacheSave (ResultsCache *cache, const char *path);
+
+// Number of lookups so far, and how many of them found their key
+void cacheStats (ResultsCache *cache, long *lookups, long *hits);
+
+#endif
@@ -0,0 +1,348 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "results_file.h"
+
+/*
+ * Files of results tables (see results_file.h for the format)
+ */
+
+#define RF_MAGIC "LCRESULT"
+#define RF_MAGIC_LEN 8
+#define RF_COUNT_OFFSET 32
+
+// Size of the output buffer of a writer
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+// Longest varint we write (a 64-bit number takes at most 10 bytes)
+#define MAX_VARINT_LEN 10
+
+
+static void putLE32 (unsigned char *buf, uint32_t x) {
+    for (int i = 0; i < 4; i += 1) {
+        buf[i] = (x >> (8 * i)) & 0xFF;
+    }
+}
+
+
+static void putLE64 (unsigned char *buf, uint64_t x) {
+    for (int i = 0; i < 8; i += 1) {
+        buf[i] = (x >> (8 * i)) & 0xFF;
+    }
+}
+
+
+static uint32_t getLE32 (const unsigned char *buf) {
+    uint32_t x = 0;
+    for (int i = 3; i >= 0; i -= 1) {
+        x = (x << 8) | buf[i];
+    }
+    return x;
+}
+
+
+static uint64_t getLE64 (const unsigned char *buf) {
+    uint64_t x = 0;
+    for (int i = 7; i >= 0; i -= 1) {
+        x = (x << 8) | buf[i];
+    }
+    return x;
+}
+
+
+// Store x as a varint at buf, returning the number of bytes used
+static int putVarint (unsigned char *buf, uint64_t x) {
+    int len = 0;
+    while (x >= 0x80) {
+        buf[len] = (x & 0x7F) | 0x80;
+        x >>= 7;
+        len += 1;
+    }
+    buf[len] = x;
+    return len + 1;
+}
+
+
+// Read a varint from [*pos, end) into *x, advancing *pos past it
+// Returns 0 on success, -1 if it runs past end
+static int getVarint (const unsigned char **pos, const unsigned char *end, uint64_t *x) {
+    *x = 0;
+    for (int shift = 0; *pos < end && shift < 64; shift += 7) {
+        unsigned char c = **pos;
+        *pos += 1;
+        *x |= (uint64_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+// Zigzag encoding maps differences 0, -1, 1, -2, 2, ... to 0, 1, 2, 3, 4, ...
+static uint64_t zigzag (int64_t x) {
+    return ((uint64_t) x << 1) ^ (uint64_t)(x >> 63);
+}
+
+
+static int64_t unzigzag (uint64_t x) {
+    return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+}
+
+
+ResultsWriter *resultsCreate (const char *path, int maxN, int flags) {
+    if (maxN < 1 || maxN > RF_MAX_N) {
+        errno = EINVAL;
+        return NULL;
+    }
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return NULL;
+    }
+    setvbuf(f, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+
+    unsigned char header[RF_HEADER_SIZE];
+    memcpy(header, RF_MAGIC, RF_MAGIC_LEN);
+    putLE32(&header[8], RF_VERSION);
+    putLE32(&header[12], flags);
+    putLE32(&header[16], maxN);
+    putLE32(&header[20], RESULTS_ROWS(maxN));
+    putLE32(&header[24], RESULTS_COLS(maxN));
+    putLE32(&header[28], 0);
+    putLE64(&header[RF_COUNT_OFFSET], 0); // Filled in by resultsClose
+    if (fwrite(header, 1, RF_HEADER_SIZE, f) != RF_HEADER_SIZE) {
+        int err = errno;
+        fclose(f);
+        errno = err;
+        return NULL;
+    }
+
+    ResultsWriter *w = (ResultsWriter*)malloc(sizeof(ResultsWriter));
+    w->f = f;
+    w->maxN = maxN;
+    w->flags = flags;
+    w->nRecords = 0;
+    w->prevLine = 0;
+    w->prevValues = (unsigned int*)calloc(RESULTS_SIZE(maxN), sizeof(unsigned int));
+    return w;
+}
+
+
+int resultsWrite (ResultsWriter *w, long line, int n, const unsigned int *results) {
+    if (n < 1 || n > w->maxN) {
+        errno = EINVAL;
+        return -1;
+    }
+    unsigned char buf[MAX_VARINT_LEN * (2 + RESULTS_SIZE(RF_MAX_N))];
+    size_t len = 0;
+
+    if (w->flags & RF_COMPRESSED) {
+        if (w->nRecords % RF_KEY_INTERVAL == 0) {
+            w->prevLine = 0;
+            memset(w->prevValues, 0, sizeof(unsigned int) * RESULTS_SIZE(w->maxN));
+        }
+        len += putVarint(&buf[len], zigzag(line - w->prevLine));
+        len += putVarint(&buf[len], n);
+        for (int i = 0; i < RESULTS_SIZE(n); i += 1) {
+            len += putVarint(&buf[len], zigzag((int64_t) results[i] - (int64_t) w->prevValues[i]));
+        }
+        w->prevLine = line;
+        memcpy(w->prevValues, results, sizeof(unsigned int) * RESULTS_SIZE(n));
+        memset(&w->prevValues[RESULTS_SIZE(n)], 0, sizeof(unsigned int) * (RESULTS_SIZE(w->maxN) - RESULTS_SIZE(n)));
+    } else {
+        putLE64(buf, line);
+        putLE32(&buf[8], n);
+        for (int i = 0; i < RESULTS_SIZE(w->maxN); i += 1) {
+            putLE32(&buf[12 + 4 * i], (i < RESULTS_SIZE(n)) ? results[i] : 0);
+        }
+        len = RF_RECORD_SIZE(w->maxN);
+    }
+
+    if (fwrite(buf, 1, len, w->f) != len) {
+        return -1;
+    }
+    w->nRecords += 1;
+    return 0;
+}
+
+
+int resultsClose (ResultsWriter *w) {
+    unsigned char count[8];
+    putLE64(count, w->nRecords);
+    int ok = (fseek(w->f, RF_COUNT_OFFSET, SEEK_SET) == 0 && fwrite(count, 1, 8, w->f) == 8);
+    int err = errno;
+    if (fclose(w->f) != 0 && ok) {
+        ok = 0;
+        err = errno;
+    }
+    free(w->prevValues);
+    free(w);
+    errno = err;
+    return ok ? 0 : -1;
+}
+
+
+// Decode the compressed record at r->nextOffset (updating r->prevLine and r->prevValues)
+// Returns 0 on success, -1 if the record is cut short or invalid
+static int decodeRecord (ResultsReader *r) {
+    if (r->nextIndex % RF_KEY_INTERVAL == 0) {
+        r->prevLine = 0;
+        memset(r->prevValues, 0, sizeof(unsigned int) * RESULTS_SIZE(r->maxN));
+    }
+    const unsigned char *pos = &r->data[r->nextOffset];
+    const unsigned char *end = &r->data[r->size];
+    uint64_t lineDiff, n;
+    if (getVarint(&pos, end, &lineDiff) < 0 || getVarint(&pos, end, &n) < 0 || n < 1 || n > (uint64_t) r->maxN) {
+        return -1;
+    }
+    for (int i = 0; i < RESULTS_SIZE(r->maxN); i += 1) {
+        uint64_t diff = 0;
+        if (i < RESULTS_SIZE(n) && getVarint(&pos, end, &diff) < 0) {
+            return -1;
+        }
+        r->prevValues[i] = (i < RESULTS_SIZE(n)) ? (unsigned int)(r->prevValues[i] + unzigzag(diff)) : 0;
+    }
+    r->prevLine += unzigzag(lineDiff);
+    r->prevValues[RESULTS_SIZE(r->maxN)] = n; // Remember n past the end of the table
+    r->nextOffset = pos - r->data;
+    r->nextIndex += 1;
+    return 0;
+}
+
+
+ResultsReader *resultsOpen (const char *path, int *err) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        *err = -1;
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        int e = errno;
+        close(fd);
+        errno = e;
+        *err = -1;
+        return NULL;
+    }
+    if (info.st_size < RF_HEADER_SIZE) {
+        close(fd);
+        *err = RF_BAD_HEADER;
+        return NULL;
+    }
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int e = errno;
+    close(fd); // The mapping stays valid
+    if (data == MAP_FAILED) {
+        errno = e;
+        *err = -1;
+        return NULL;
+    }
+
+    ResultsReader *r = (ResultsReader*)malloc(sizeof(ResultsReader));
+    r->data = (const unsigned char*)data;
+    r->size = info.st_size;
+    r->maxN = getLE32(&r->data[16]);
+    r->flags = getLE32(&r->data[12]);
+    r->keyOffsets = NULL;
+    r->prevValues = NULL;
+    if (memcmp(r->data, RF_MAGIC, RF_MAGIC_LEN) != 0 || getLE32(&r->data[8]) != RF_VERSION || r->maxN < 1 || r->maxN > RF_MAX_N
+            || getLE32(&r->data[20]) != RESULTS_ROWS(r->maxN) || getLE32(&r->data[24]) != RESULTS_COLS(r->maxN)) {
+        resultsCloseReader(r);
+        *err = RF_BAD_HEADER;
+        return NULL;
+    }
+
+    if (r->flags & RF_COMPRESSED) {
+        // Find the key records (and check that every record can be decoded)
+        size_t keyCap = 16;
+        r->keyOffsets = (size_t*)malloc(sizeof(size_t) * keyCap);
+        r->prevValues = (unsigned int*)malloc(sizeof(unsigned int) * (RESULTS_SIZE(r->maxN) + 1));
+        r->nextIndex = 0;
+        r->nextOffset = RF_HEADER_SIZE;
+        while (r->nextOffset < r->size) {
+            if (r->nextIndex % RF_KEY_INTERVAL == 0) {
+                if ((size_t) r->nextIndex / RF_KEY_INTERVAL == keyCap) {
+                    keyCap *= 2;
+                    r->keyOffsets = (size_t*)realloc(r->keyOffsets, sizeof(size_t) * keyCap);
+                }
+                r->keyOffsets[r->nextIndex / RF_KEY_INTERVAL] = r->nextOffset;
+            }
+            if (decodeRecord(r) < 0) {
+                resultsCloseReader(r);
+                *err = RF_TRUNCATED;
+                return NULL;
+            }
+        }
+        r->nRecords = r->nextIndex;
+    } else {
+        size_t body = r->size - RF_HEADER_SIZE;
+        if (body % RF_RECORD_SIZE(r->maxN) != 0) {
+            resultsCloseReader(r);
+            *err = RF_TRUNCATED;
+            return NULL;
+        }
+        r->nRecords = body / RF_RECORD_SIZE(r->maxN);
+    }
+    *err = 0;
+    return r;
+}
+
+
+int resultsRead (ResultsReader *r, long index, long *line, int *n, unsigned int *results) {
+    if (index < 0 || index >= r->nRecords) {
+        return -1;
+    }
+
+    if (r->flags & RF_COMPRESSED) {
+        // The last record decoded is r->nextIndex - 1, so we can carry on from there unless the record is
+        //  before it or after the next key record
+        if (index != r->nextIndex - 1) {
+            if (index < r->nextIndex || index / RF_KEY_INTERVAL > r->nextIndex / RF_KEY_INTERVAL) {
+                r->nextIndex = index - index % RF_KEY_INTERVAL;
+                r->nextOffset = r->keyOffsets[index / RF_KEY_INTERVAL];
+            }
+            while (r->nextIndex <= index) {
+                decodeRecord(r); // Can't fail, since resultsOpen decoded everything once
+            }
+        }
+        *line = r->prevLine;
+        *n = r->prevValues[RESULTS_SIZE(r->maxN)];
+        memcpy(results, r->prevValues, sizeof(unsigned int) * RESULTS_SIZE(r->maxN));
+    } else {
+        const unsigned char *record = &r->data[RF_HEADER_SIZE + (size_t) index * RF_RECORD_SIZE(r->maxN)];
+        *line = getLE64(record);
+        *n = getLE32(&record[8]);
+        if (*n < 1 || *n > r->maxN) {
+            return -1;
+        }
+        for (int i = 0; i < RESULTS_SIZE(r->maxN); i += 1) {
+            results[i] = getLE32(&record[12 + 4 * i]);
+        }
+    }
+    return 0;
+}
+
+
+void resultsCloseReader (ResultsReader *r) {
+    munmap((void*)r->data, r->size);
+    free(r->keyOffsets);
+    free(r->prevValues);
+    free(r);
+}
+
+
+const char *resultsErrorString (int err) {
+    switch (err) {
+        case RF_BAD_HEADER:
+            return "not a results file (or an unsupported version)";
+        case RF_TRUNCATED:
+            return "results file is truncated";
+        default:
+            return "unknown error";
+    }
+}
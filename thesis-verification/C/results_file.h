@@ -0,0 +1,100 @@
+#ifndef RESULTS_FILE_H
+#define RESULTS_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Files of results tables (the partition counts of each graph, see log_conc_check.c)
+ *
+ * The counts for a graph on n vertices form a table with RESULTS_ROWS(n) rows and RESULTS_COLS(n) columns,
+ *  stored row by row. A results file starts with a header
+ *      bytes 0-7    "LCRESULT"
+ *      bytes 8-11   format version (RF_VERSION)
+ *      bytes 12-15  flags (RF_COMPRESSED)
+ *      bytes 16-19  maxN, the largest number of vertices of a graph in the file
+ *      bytes 20-23  RESULTS_ROWS(maxN)
+ *      bytes 24-27  RESULTS_COLS(maxN)
+ *      bytes 28-31  0
+ *      bytes 32-39  number of records
+ *  followed by one record per graph, in the order the graphs were read. All numbers are little-endian.
+ * Without RF_COMPRESSED, every record takes RF_RECORD_SIZE(maxN) bytes: the line of the graph in its g6 file
+ *  (8 bytes), its number of vertices n (4 bytes), and its table (4 bytes per entry) padded with zeros to
+ *  RESULTS_SIZE(maxN) entries. So record i can be found without reading the ones before it.
+ * With RF_COMPRESSED, a record is a list of varints (7 bits per byte, least significant first, high bit set on
+ *  all but the last byte): the line minus the line of the previous record, n, and then for each of the
+ *  RESULTS_SIZE(n) entries of the table the zigzag encoded difference from the same entry of the previous
+ *  record (whose table is padded with zeros as above). Every RF_KEY_INTERVAL-th record (starting with the
+ *  first) is a key record, encoded as if the previous record had line 0 and all entries 0, so that decoding
+ *  can start from any key record.
+ */
+
+#define RESULTS_ROWS(n) (((n) / 2) + 1)
+#define RESULTS_COLS(n) ((n) + 1)
+#define RESULTS_SIZE(n) (RESULTS_ROWS(n) * RESULTS_COLS(n))
+
+#define RF_VERSION 1
+#define RF_COMPRESSED 1
+#define RF_HEADER_SIZE 40
+#define RF_RECORD_SIZE(maxN) (12 + 4 * RESULTS_SIZE(maxN))
+#define RF_KEY_INTERVAL 256
+
+// Largest maxN we accept
+#define RF_MAX_N 64
+
+// Error codes returned by resultsOpen (besides -1 with errno set)
+#define RF_BAD_HEADER -2   // not a results file, or a version we can't read
+#define RF_TRUNCATED -3    // the file ends in the middle of a record
+
+typedef struct ResultsWriter {
+    FILE *f;
+    int maxN;
+    int flags;
+    long nRecords;
+    long prevLine;            // for compressed files
+    unsigned int *prevValues; // for compressed files (RESULTS_SIZE(maxN) entries)
+} ResultsWriter;
+
+typedef struct ResultsReader {
+    const unsigned char *data;
+    size_t size;
+    int maxN;
+    int flags;
+    long nRecords;
+    // For compressed files
+    size_t *keyOffsets; // offset of each key record
+    long nextIndex;     // index of the record at nextOffset, decoded relative to prevLine and prevValues
+    size_t nextOffset;
+    long prevLine;
+    unsigned int *prevValues;
+} ResultsReader;
+
+
+// Create (or truncate) the file at 'path' for graphs with at most maxN vertices
+// 'flags' is 0 or RF_COMPRESSED
+// Returns NULL (with errno set) on failure
+ResultsWriter *resultsCreate (const char *path, int maxN, int flags);
+
+// Append the table of a graph with n vertices (n <= maxN) from the given line
+// Returns 0 on success, -1 (with errno set) on failure
+int resultsWrite (ResultsWriter *w, long line, int n, const unsigned int *results);
+
+// Finish the file (filling in the number of records) and free w
+// Returns 0 on success, -1 (with errno set) on failure
+int resultsClose (ResultsWriter *w);
+
+// Map the results file at 'path'
+// Returns NULL on failure, storing -1 (with errno set) or one of the error codes above in *err
+ResultsReader *resultsOpen (const char *path, int *err);
+
+// Read record number 'index' (from 0) into *line, *n, and 'results' (which needs RESULTS_SIZE(r->maxN) entries)
+// Reading the records in order is fast for compressed files too
+// Returns 0 on success, -1 if there is no such record (or it is invalid)
+int resultsRead (ResultsReader *r, long index, long *line, int *n, unsigned int *results);
+
+void resultsCloseReader (ResultsReader *r);
+
+// Returns a description of one of the error codes above
+const char *resultsErrorString (int err);
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef STABLE_PARTITIONS_H
+#define STABLE_PARTITIONS_H
+
+#include <stdlib.h>
+#include "../../graph-utilities/bitgraph.h"
+
+/*
+ * Partitions of vertex subsets into stable sets, by dynamic programming over the subsets of V(g)
+ *
+ * Let a_m(X) be the number of partitions of X into m stable parts, and alpha[m][r] the sum of a_m(X) over all X
+ *  with |X| = r. Since sum_m a_m(X) (y)_m is the chromatic polynomial of g[X], everything which is a sum over
+ *  partitions of V(g) or over induced subgraphs of g can be worked out from the alpha's (see log_conc_check.c
+ *  and bichrom.h). The a_m(X) are computed by removing the part containing the least element of X, which costs
+ *  about 3^n steps in total.
+ * All arithmetic is done with unsigned (wrapping) 64-bit integers. No a_m(X) or alpha[m][r] is larger than
+ *  C(n,r) times the Bell number of r, which is less than 2^64 for n <= STABLE_MAX_N.
+ */
+
+// Largest number of vertices the tables are made for
+#define STABLE_MAX_N 16
+
+#define NUM_SUBSETS(n) (1 << (n))
+
+// alpha[m][r] (see above)
+typedef unsigned long long AlphaTable[STABLE_MAX_N + 1][STABLE_MAX_N + 1];
+
+// Per-graph tables (see ensureSubsetTables)
+// 'stable' has NUM_SUBSETS(maxN) entries and 'stablePrtns' has NUM_SUBSETS(maxN) * (maxN + 1) entries
+typedef struct SubsetTables {
+    int maxN;                         // largest number of vertices the tables have room for
+    char *stable;                     // stable[X] is 1 if the vertex subset X is stable, 0 otherwise
+    unsigned long long *stablePrtns;  // stablePrtns[X * (n + 1) + m] = a_m(X)
+} SubsetTables;
+
+
+// Start with empty tables
+static inline void initSubsetTables (SubsetTables *tables) {
+    tables->maxN = 0;
+    tables->stable = NULL;
+    tables->stablePrtns = NULL;
+}
+
+
+static inline void freeSubsetTables (SubsetTables *tables) {
+    free(tables->stable);
+    free(tables->stablePrtns);
+}
+
+
+// Make sure 'tables' has room for graphs with n vertices
+static inline void ensureSubsetTables (SubsetTables *tables, int n) {
+    if (tables->maxN < n) {
+        tables->maxN = n;
+        tables->stable = (char*)realloc(tables->stable, sizeof(char) * NUM_SUBSETS(n));
+        tables->stablePrtns = (unsigned long long*)realloc(tables->stablePrtns,
+                                  sizeof(unsigned long long) * NUM_SUBSETS(n) * (n + 1));
+    }
+}
+
+
+// Sum the numbers a_m(X) of partitions of subsets X of V(g) into m stable parts by the size of X: alpha[m][r]
+//  is the sum over all X with |X| = r, and if 'rooted' is 1, alphaRoot[m][r] is the sum over the X which contain
+//  vertex 0
+// Always inlined, so that callers passing a constant n (and 'rooted') get a copy specialised for it
+// Assumes g has n <= STABLE_MAX_N vertices and 'tables' has room for n vertices
+static inline __attribute__((always_inline))
+void sumStablePartitions (const Graph *g, SubsetTables *tables, AlphaTable alpha, AlphaTable alphaRoot, const int n, const int rooted) {
+    char *stable = tables->stable;
+    unsigned long long *a = tables->stablePrtns;
+
+    fillStableTable(g, stable);
+
+    for (int m = 0; m <= n; m += 1) {
+        a[m] = (m == 0);
+        for (int r = 0; r <= n; r += 1) {
+            alpha[m][r] = 0;
+            if (rooted) {
+                alphaRoot[m][r] = 0;
+            }
+        }
+    }
+    alpha[0][0] = 1;
+
+    for (unsigned int X = 1; X < NUM_SUBSETS(n); X += 1) {
+        unsigned long long *aX = &a[X * (n + 1)];
+        int size = __builtin_popcount(X);
+        for (int m = 0; m <= n; m += 1) {
+            aX[m] = 0;
+        }
+
+        // Run over the stable parts B of X containing the least element of X
+        unsigned int low = X & -X;
+        unsigned int others = X ^ low;
+        unsigned int T = others;
+        while (1) {
+            unsigned int B = T | low;
+            if (stable[B]) {
+                unsigned long long *aRest = &a[(X ^ B) * (n + 1)];
+                int restSize = size - __builtin_popcount(B);
+                for (int m = 0; m <= restSize; m += 1) {
+                    aX[m + 1] += aRest[m];
+                }
+            }
+            if (T == 0) {
+                break;
+            }
+            T = (T - 1) & others;
+        }
+
+        for (int m = 1; m <= size; m += 1) {
+            alpha[m][size] += aX[m];
+        }
+        if (rooted && (X & 1)) {
+            for (int m = 1; m <= size; m += 1) {
+                alphaRoot[m][size] += aX[m];
+            }
+        }
+    }
+}
+
+#endif